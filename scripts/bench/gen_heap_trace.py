@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# MooseOS Heap benchmark
+# Copyright (c) 2025 Ethan Zhang
+# Licensed under the MIT license. See license file for details
+#
+# Writes a SYNTHETIC allocation trace for scripts/bench/heap_bench.c.
+# It is shaped like a filesystem load followed by an editing session
+# (node structs, child arrays that double with krealloc, file contents,
+# then contents that grow and shrink while files come and go).
+# It is not a recording. For real numbers, capture a trace from a kernel
+# built with -DHEAP_TRACE and replay the serial log instead.
+#
+# Usage: gen_heap_trace.py [--seed N] [--files N] [--edits N] > trace.txt
+
+import argparse
+import random
+
+FILE_STRUCT_SIZE = 148  # sizeof(File) on i386
+MAX_CONTENT = 4096
+
+
+class Trace:
+    def __init__(self):
+        self.next_id = 1
+        self.lines = []
+
+    def alloc(self, size):
+        ident = self.next_id
+        self.next_id += 1
+        self.lines.append("a %x %d" % (ident, size))
+        return ident
+
+    def free(self, ident):
+        self.lines.append("f %x" % ident)
+
+    def realloc(self, ident, size):
+        new_ident = self.next_id
+        self.next_id += 1
+        self.lines.append("r %x %x %d" % (ident, new_ident, size))
+        return new_ident
+
+
+def content_size(rng):
+    # mostly small text files, a few close to the content limit
+    if rng.random() < 0.8:
+        return rng.randint(1, 512)
+    return rng.randint(512, MAX_CONTENT)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="synthetic heap trace generator")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--files", type=int, default=2000)
+    parser.add_argument("--edits", type=int, default=20000)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    trace = Trace()
+
+    # directory -> [children array id, capacity, child count]
+    dirs = {0: [None, 0, 0]}
+    files = {}  # node -> [content id, content size, struct id]
+    next_node = 1
+
+    def add_child(parent):
+        entry = dirs[parent]
+        if entry[0] is None:
+            entry[0] = trace.alloc(4 * 4)
+            entry[1] = 4
+        elif entry[2] >= entry[1]:
+            entry[1] *= 2
+            entry[0] = trace.realloc(entry[0], entry[1] * 4)
+        entry[2] += 1
+
+    # filesystem load: every node gets a struct and a slot in its parent
+    for _ in range(args.files):
+        parent = rng.choice(list(dirs))
+        struct = trace.alloc(FILE_STRUCT_SIZE)
+        add_child(parent)
+        node = next_node
+        next_node += 1
+        if rng.random() < 0.15:
+            dirs[node] = [None, 0, 0]
+        else:
+            size = content_size(rng)
+            files[node] = [trace.alloc(size + 1), size, struct]
+
+    # editing session: type into files, save, create and delete scratch files
+    for _ in range(args.edits):
+        roll = rng.random()
+        if roll < 0.7 and files:
+            node = rng.choice(list(files))
+            content = files[node]
+            delta = rng.randint(-64, 128)
+            size = max(1, min(MAX_CONTENT - 1, content[1] + delta))
+            content[0] = trace.realloc(content[0], size + 1)
+            content[1] = size
+        elif roll < 0.85:
+            struct = trace.alloc(FILE_STRUCT_SIZE)
+            add_child(rng.choice(list(dirs)))
+            size = content_size(rng)
+            files[next_node] = [trace.alloc(size + 1), size, struct]
+            next_node += 1
+        elif files:
+            node = rng.choice(list(files))
+            content, _, struct = files.pop(node)
+            trace.free(content)
+            trace.free(struct)
+
+    print("# synthetic heap trace: gen_heap_trace.py --seed %d --files %d --edits %d"
+          % (args.seed, args.files, args.edits))
+    print("\n".join(trace.lines))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,439 @@
+/*
+    MooseOS Heap benchmark
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Replays an allocation trace against sys/mem/src/heap/heap.c built
+    for the host, and reports speed, peak footprint and fragmentation.
+    Build and run it with `make bench-heap`.
+
+    Trace lines (ids are hex, sizes are decimal):
+        a <id> <size>           kmalloc
+        f <id>                  kfree
+        r <id> <new id> <size>  krealloc
+    A kernel built with -DHEAP_TRACE prints these lines to serial with a
+    "[HEAPTRACE] " prefix. Every other line in the file is ignored, so a
+    saved serial log can be replayed as it is.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include "heap/heap.h"
+
+#define BENCH_PAGE_SIZE 4096
+#define TRACE_PREFIX "[HEAPTRACE] "
+
+// one replayed call, ids are already resolved to slots
+typedef struct {
+    char op;
+    uint32_t slot;
+    uint32_t size;
+} trace_op;
+
+// a live allocation
+typedef struct {
+    void *ptr;
+    uint32_t size;
+} trace_slot;
+
+// the heap's virtual ranges, see hosted.h
+char heap_bench_arena[HEAP_BENCH_ARENA_SIZE] __attribute__((aligned(BENCH_PAGE_SIZE)));
+char heap_bench_large_arena[HEAP_BENCH_ARENA_SIZE] __attribute__((aligned(BENCH_PAGE_SIZE)));
+
+/**
+ * stand-ins for the paging code the heap calls into.
+ * frames are only counted, the arena is already backed by the host.
+ */
+typedef uint32_t page_directory_t[1024];
+page_directory_t *kernel_directory = NULL;
+static size_t frames_in_use = 0;
+
+/**
+ * a reserved arena is made inaccessible and pages are opened up on
+ * first touch, like the kernel's demand paging, so they can be counted.
+ * the heap only ever reserves the arenas from hosted.h. addresses come in
+ * cut to 32 bits, so arenas are told apart by their low bits.
+ */
+static char *const arenas[] = { heap_bench_arena, heap_bench_large_arena };
+#define ARENA_COUNT (sizeof(arenas) / sizeof(arenas[0]))
+#define ARENA_PAGES (HEAP_BENCH_ARENA_SIZE / BENCH_PAGE_SIZE)
+static uint8_t touched[ARENA_COUNT][ARENA_PAGES];
+static uint32_t arena_pages[ARENA_COUNT];
+
+/**
+ * @return arena holding a 32 bit address, ARENA_COUNT if none does
+ */
+static size_t find_arena(uint32_t addr, size_t *offset) {
+    for (size_t i = 0; i < ARENA_COUNT; i++) {
+        uint32_t delta = addr - (uint32_t)(uintptr_t)arenas[i];
+        if (delta < HEAP_BENCH_ARENA_SIZE) {
+            *offset = delta;
+            return i;
+        }
+    }
+    return ARENA_COUNT;
+}
+
+static void arena_fault(int sig, siginfo_t *info, void *context) {
+    char *addr = info->si_addr;
+    for (size_t i = 0; i < ARENA_COUNT; i++) {
+        if (addr >= arenas[i] && addr < arenas[i] + HEAP_BENCH_ARENA_SIZE) {
+            size_t page = (size_t)(addr - arenas[i]) / BENCH_PAGE_SIZE;
+            mprotect(arenas[i] + page * BENCH_PAGE_SIZE, BENCH_PAGE_SIZE, PROT_READ | PROT_WRITE);
+            touched[i][page] = 1;
+            arena_pages[i]++;
+            frames_in_use++;
+            return;
+        }
+    }
+    signal(sig, SIG_DFL); // a real crash, let it happen
+}
+
+bool paging_reserve(uint32_t start, uint32_t size, uint32_t flags, page_directory_t *dir) {
+    size_t offset;
+    size_t arena = find_arena(start, &offset);
+    if (arena == ARENA_COUNT) {
+        return false;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = arena_fault;
+    action.sa_flags = SA_SIGINFO;
+    sigaction(SIGSEGV, &action, NULL);
+    sigaction(SIGBUS, &action, NULL); // macOS reports protection faults as SIGBUS
+    return mprotect(arenas[arena], HEAP_BENCH_ARENA_SIZE, PROT_NONE) == 0;
+}
+
+void paging_discard(uint32_t start, uint32_t size, page_directory_t *dir) {
+    size_t offset;
+    size_t arena = find_arena(start, &offset);
+    if (arena == ARENA_COUNT) {
+        return;
+    }
+    for (size_t page = offset / BENCH_PAGE_SIZE; page < (offset + size) / BENCH_PAGE_SIZE; page++) {
+        if (touched[arena][page]) {
+            char *addr = arenas[arena] + page * BENCH_PAGE_SIZE;
+            madvise(addr, BENCH_PAGE_SIZE, MADV_DONTNEED);
+            mprotect(addr, BENCH_PAGE_SIZE, PROT_NONE);
+            touched[arena][page] = 0;
+            arena_pages[arena]--;
+            frames_in_use--;
+        }
+    }
+}
+
+uint32_t paging_reserved_pages(uint32_t start, page_directory_t *dir) {
+    size_t offset;
+    size_t arena = find_arena(start, &offset);
+    return arena == ARENA_COUNT ? 0 : arena_pages[arena];
+}
+
+uint32_t frame_free_count(void) {
+    return UINT32_MAX;
+}
+
+bool paging_commit(uint32_t start, uint32_t pages, page_directory_t *dir) {
+    return true;
+}
+
+// older heaps map every page themselves
+uint32_t alloc_frame(void) {
+    frames_in_use++;
+    return (uint32_t)(frames_in_use * BENCH_PAGE_SIZE);
+}
+
+void free_frame(uint32_t frame_addr) {
+    frames_in_use--;
+}
+
+bool map_page(uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags, page_directory_t *dir) {
+    return true;
+}
+
+bool unmap_page(uint32_t virtual_addr, page_directory_t *dir) {
+    return true;
+}
+
+uint32_t paging_global_flag(void) {
+    return 0;
+}
+
+// the kernel hangs on a failed assertion, count them so old heaps can still be compared
+static size_t assert_failures = 0;
+
+void assert(int condition) {
+    if (!condition) {
+        assert_failures++;
+    }
+}
+
+void debugf(const char *str) {
+}
+
+// both the current heap and the old first-fit heap export their break
+void *sbrk(int increment);
+
+static trace_op *ops = NULL;
+static size_t op_count = 0;
+static size_t op_capacity = 0;
+static uint32_t slot_count = 0;
+static size_t counts[3]; // a, f, r
+
+// id to slot map, open addressing, ids are only ever overwritten
+static uint64_t *map_ids = NULL;
+static uint32_t *map_slots = NULL;
+static size_t map_capacity = 0;
+static size_t map_used = 0;
+
+static size_t map_find(uint64_t id) {
+    size_t index = (size_t)((id * 0x9E3779B97F4A7C15ull) >> 20) & (map_capacity - 1);
+    while (map_slots[index] != UINT32_MAX && map_ids[index] != id) {
+        index = (index + 1) & (map_capacity - 1);
+    }
+    return index;
+}
+
+static void map_grow(void) {
+    uint64_t *old_ids = map_ids;
+    uint32_t *old_slots = map_slots;
+    size_t old_capacity = map_capacity;
+
+    map_capacity = map_capacity ? map_capacity * 2 : 1024;
+    map_ids = calloc(map_capacity, sizeof(uint64_t));
+    map_slots = malloc(map_capacity * sizeof(uint32_t));
+    if (!map_ids || !map_slots) {
+        fprintf(stderr, "heap_bench: out of memory\n");
+        exit(1);
+    }
+    memset(map_slots, 0xFF, map_capacity * sizeof(uint32_t));
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i] != UINT32_MAX) {
+            size_t index = map_find(old_ids[i]);
+            map_ids[index] = old_ids[i];
+            map_slots[index] = old_slots[i];
+        }
+    }
+    free(old_ids);
+    free(old_slots);
+}
+
+static void map_set(uint64_t id, uint32_t slot) {
+    if ((map_used + 1) * 2 > map_capacity) {
+        map_grow();
+    }
+    size_t index = map_find(id);
+    if (map_slots[index] == UINT32_MAX) {
+        map_used++;
+    }
+    map_ids[index] = id;
+    map_slots[index] = slot;
+}
+
+/**
+ * @return slot of a live id, or UINT32_MAX if the id was never allocated
+ */
+static uint32_t map_get(uint64_t id) {
+    if (!map_capacity) {
+        return UINT32_MAX;
+    }
+    return map_slots[map_find(id)];
+}
+
+static void push_op(char op, uint32_t slot, uint32_t size) {
+    if (op_count == op_capacity) {
+        op_capacity = op_capacity ? op_capacity * 2 : 4096;
+        ops = realloc(ops, op_capacity * sizeof(trace_op));
+        if (!ops) {
+            fprintf(stderr, "heap_bench: out of memory\n");
+            exit(1);
+        }
+    }
+    ops[op_count].op = op;
+    ops[op_count].slot = slot;
+    ops[op_count].size = size;
+    op_count++;
+}
+
+/**
+ * read a trace and resolve every id to a slot
+ * @return false if the file cannot be read
+ */
+static bool load_trace(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char *cursor = strstr(line, TRACE_PREFIX);
+        cursor = cursor ? cursor + strlen(TRACE_PREFIX) : line;
+
+        char op = cursor[0];
+        if ((op != 'a' && op != 'f' && op != 'r') || cursor[1] != ' ') {
+            continue; // not a trace line
+        }
+
+        char *end;
+        uint64_t id = strtoull(cursor + 2, &end, 16);
+        if (op == 'a') {
+            uint32_t size = (uint32_t)strtoul(end, NULL, 10);
+            map_set(id, slot_count);
+            push_op('a', slot_count++, size);
+            counts[0]++;
+        } else if (op == 'f') {
+            uint32_t slot = map_get(id);
+            if (slot == UINT32_MAX) {
+                continue; // freed something we never saw allocated
+            }
+            push_op('f', slot, 0);
+            counts[1]++;
+        } else {
+            uint64_t new_id = strtoull(end, &end, 16);
+            uint32_t size = (uint32_t)strtoul(end, NULL, 10);
+            uint32_t slot = map_get(id);
+            if (slot == UINT32_MAX) {
+                slot = slot_count++; // realloc of an unknown pointer acts like malloc
+            }
+            map_set(new_id, slot);
+            push_op('r', slot, size);
+            counts[2]++;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace> [passes]\n", argv[0]);
+        return 1;
+    }
+    int passes = argc > 2 ? atoi(argv[2]) : 5;
+    if (passes < 1) {
+        passes = 1;
+    }
+
+    if (!load_trace(argv[1])) {
+        fprintf(stderr, "heap_bench: cannot read %s\n", argv[1]);
+        return 1;
+    }
+    if (!op_count) {
+        fprintf(stderr, "heap_bench: no trace lines in %s\n", argv[1]);
+        return 1;
+    }
+
+    trace_slot *slots = calloc(slot_count, sizeof(trace_slot));
+    if (!slots) {
+        fprintf(stderr, "heap_bench: out of memory\n");
+        return 1;
+    }
+
+    char *break_start = sbrk(0);
+    size_t live = 0, peak_live = 0;
+    size_t footprint = 0, peak_footprint = 0;
+    size_t failures = 0;
+    double elapsed = 0;
+
+    for (int pass = 0; pass < passes; pass++) {
+        double start = now_ns();
+        for (size_t i = 0; i < op_count; i++) {
+            trace_op *op = &ops[i];
+            trace_slot *slot = &slots[op->slot];
+
+            if (op->op == 'a') {
+                slot->ptr = kmalloc(op->size);
+                if (slot->ptr) {
+                    // touch both ends like a real user would
+                    if (op->size) {
+                        ((char*)slot->ptr)[0] = 1;
+                        ((char*)slot->ptr)[op->size - 1] = 1;
+                    }
+                    slot->size = op->size;
+                    live += op->size;
+                } else {
+                    failures++;
+                }
+            } else if (op->op == 'f') {
+                if (slot->ptr) {
+                    kfree(slot->ptr);
+                    live -= slot->size;
+                    slot->ptr = NULL;
+                }
+            } else {
+                void *ptr = krealloc(slot->ptr, op->size);
+                if (ptr) {
+                    if (op->size) {
+                        ((char*)ptr)[op->size - 1] = 1;
+                    }
+                    live += op->size;
+                    live -= slot->ptr ? slot->size : 0;
+                    slot->ptr = ptr;
+                    slot->size = op->size;
+                } else {
+                    failures++;
+                }
+            }
+
+            // the heap either backs pages or just moves its break
+            footprint = frames_in_use * BENCH_PAGE_SIZE;
+            size_t break_size = (size_t)((char*)sbrk(0) - break_start);
+            if (break_size > footprint) {
+                footprint = break_size;
+            }
+            if (footprint > peak_footprint) {
+                peak_footprint = footprint;
+            }
+            if (live > peak_live) {
+                peak_live = live;
+            }
+        }
+        elapsed += now_ns() - start;
+
+        if (pass + 1 < passes) {
+            // drop whatever the trace left behind before replaying it again
+            for (uint32_t i = 0; i < slot_count; i++) {
+                if (slots[i].ptr) {
+                    kfree(slots[i].ptr);
+                    live -= slots[i].size;
+                    slots[i].ptr = NULL;
+                }
+            }
+        }
+    }
+
+    printf("trace:              %s\n", argv[1]);
+    printf("operations:         %zu (a %zu, f %zu, r %zu) x %d passes\n",
+           op_count, counts[0], counts[1], counts[2], passes);
+    printf("time:               %.1f ns/op\n", elapsed / ((double)op_count * passes));
+    printf("peak live:          %zu bytes\n", peak_live);
+    printf("peak footprint:     %zu bytes\n", peak_footprint);
+    if (peak_live) {
+        printf("overhead:           %.2fx peak live\n", (double)peak_footprint / peak_live);
+    }
+    if (footprint) {
+        printf("end fragmentation:  %.1f%% of %zu bytes unused\n",
+               100.0 * (double)(footprint - (live < footprint ? live : footprint)) / footprint,
+               footprint);
+    }
+    printf("failed allocations: %zu\n", failures);
+    if (assert_failures) {
+        printf("failed assertions:  %zu (the kernel would have hung)\n", assert_failures);
+    }
+    return 0;
+}
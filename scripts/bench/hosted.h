@@ -0,0 +1,25 @@
+/*
+    MooseOS Heap benchmark
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Force-included (-include) into every file of the host heap benchmark.
+    The kernel heap's reserved virtual ranges become plain arrays,
+    so heap.c runs unmodified as a normal process.
+*/
+#ifndef HEAP_BENCH_HOSTED_H
+#define HEAP_BENCH_HOSTED_H
+
+#include <stdint.h>
+
+// same size as KERNEL_HEAP_SIZE, untouched pages cost nothing on the host
+#define HEAP_BENCH_ARENA_SIZE 0x10000000
+
+extern char heap_bench_arena[HEAP_BENCH_ARENA_SIZE];
+#define KERNEL_HEAP_START ((uintptr_t)heap_bench_arena)
+
+// same size as KERNEL_LARGE_SIZE, for the large object range
+extern char heap_bench_large_arena[HEAP_BENCH_ARENA_SIZE];
+#define KERNEL_LARGE_START ((uintptr_t)heap_bench_large_arena)
+
+#endif // HEAP_BENCH_HOSTED_H
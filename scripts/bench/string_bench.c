@@ -0,0 +1,252 @@
+/*
+    MooseOS String benchmark
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Times sys/libc/src/string/string.c built for the host against the
+    byte-at-a-time loops it replaced, and checks that both give the
+    same answers. Build and run it with `make bench-string`.
+
+    The kernel functions are renamed with a kernel_ prefix on the
+    command line, so they do not clash with the host C library.
+    Two workloads are timed: short file names like directory lookups
+    see them, and longer lines like the terminal and text layout see.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "string/string.h"
+
+#define BENCH_STRINGS 4096
+#define BENCH_ROUNDS 200
+
+// one generated string, stored at a random alignment
+typedef struct {
+    char *text;
+    size_t len;
+    char *block; // as returned by malloc
+} bench_string;
+
+typedef struct {
+    const char *name;
+    size_t min_len;
+    size_t max_len;
+} bench_workload;
+
+static const bench_workload workloads[] = {
+    { "names", 3, 31 },
+    { "lines", 32, 255 },
+};
+
+// the host cannot turn SSE on for the kernel, the word variants are timed
+bool cpu_enable_sse(void) {
+    return false;
+}
+
+/**
+ * the versions string.c had before, and plain loops for the functions it lacked
+ */
+static size_t byte_strlen(const char *str) {
+    size_t len = 0;
+    while (str[len])
+        len++;
+    return len;
+}
+
+static int byte_strcmp(const char *a, const char *b) {
+    int i = 0;
+    while (a[i] && b[i]) {
+        if (a[i] != b[i]) return 0;
+        i++;
+    }
+    return a[i] == b[i];
+}
+
+static void byte_strcpy(char *dest, const char *src) {
+    int i = 0;
+    while (src[i] && i < MAX_NAME_LEN - 1) {
+        dest[i] = src[i];
+        i++;
+    }
+    dest[i] = '\0';
+}
+
+static char *byte_strcat(char *dest, const char *src) {
+    int dest_len = 0;
+    while (dest[dest_len] != '\0') {
+        dest_len++;
+    }
+    int i = 0;
+    while (src[i] != '\0') {
+        dest[dest_len + i] = src[i];
+        i++;
+    }
+    dest[dest_len + i] = '\0';
+    return dest;
+}
+
+static char *byte_strchr(const char *str, int c) {
+    while (*str != (char)c) {
+        if (!*str) return NULL;
+        str++;
+    }
+    return (char *)str;
+}
+
+static int byte_strncmp(const char *a, const char *b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i] || !a[i]) {
+            return (unsigned char)a[i] - (unsigned char)b[i];
+        }
+    }
+    return 0;
+}
+
+static void *byte_memchr(const void *ptr, int c, size_t n) {
+    const unsigned char *p = ptr;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == (unsigned char)c) return (void *)(p + i);
+    }
+    return NULL;
+}
+
+static bench_string strings[BENCH_STRINGS];
+static bench_string copies[BENCH_STRINGS]; // same text, another alignment
+static char scratch[1024];
+static volatile size_t sink; // keeps results alive
+
+static void make_strings(const bench_workload *workload) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_. ";
+    for (int i = 0; i < BENCH_STRINGS; i++) {
+        size_t len = workload->min_len
+                     + (size_t)rand() % (workload->max_len - workload->min_len + 1);
+        free(strings[i].block);
+        free(copies[i].block);
+        strings[i].block = malloc(len + 8);
+        copies[i].block = malloc(len + 8);
+        if (!strings[i].block || !copies[i].block) {
+            fprintf(stderr, "string_bench: out of memory\n");
+            exit(1);
+        }
+        strings[i].text = strings[i].block + rand() % 4;
+        copies[i].text = copies[i].block + rand() % 4;
+        strings[i].len = copies[i].len = len;
+        for (size_t j = 0; j < len; j++) {
+            strings[i].text[j] = copies[i].text[j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        }
+        strings[i].text[len] = copies[i].text[len] = '\0';
+        // some lookups miss late in the name
+        if (i % 4 == 0) {
+            copies[i].text[len - 1] ^= 1;
+        }
+    }
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// one call per string per round, the result is ns per call
+#define TIME_CALLS(result, call)                                        \
+    do {                                                                \
+        double start_ = now_ns();                                       \
+        for (int round_ = 0; round_ < BENCH_ROUNDS; round_++) {         \
+            for (int i = 0; i < BENCH_STRINGS; i++) {                   \
+                call;                                                   \
+            }                                                           \
+        }                                                               \
+        result = (now_ns() - start_) / ((double)BENCH_ROUNDS * BENCH_STRINGS); \
+    } while (0)
+
+static size_t mismatches = 0;
+
+static void check(bool ok, const char *what, int index) {
+    if (!ok && mismatches++ < 10) {
+        fprintf(stderr, "string_bench: %s differs for string %d\n", what, index);
+    }
+}
+
+static void report(const char *name, double old_ns, double new_ns) {
+    printf("  %-8s %8.1f ns  %8.1f ns  %5.2fx\n", name, old_ns, new_ns, old_ns / new_ns);
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+static void run_workload(const bench_workload *workload) {
+    make_strings(workload);
+
+    // answers first, so a fast but wrong version does not go unnoticed
+    for (int i = 0; i < BENCH_STRINGS; i++) {
+        const char *s = strings[i].text;
+        const char *t = copies[i].text;
+        size_t len = strings[i].len;
+        char c = s[len / 2];
+        check(kernel_strlen(s) == byte_strlen(s), "strlen", i);
+        check(kernel_strcmp(s, t) == byte_strcmp(s, t), "strcmp", i);
+        check(sign(kernel_strncmp(s, t, len)) == sign(byte_strncmp(s, t, len)), "strncmp", i);
+        check(kernel_strchr(s, c) == byte_strchr(s, c), "strchr", i);
+        check(kernel_strchr(s, '#') == NULL, "strchr miss", i);
+        check(kernel_memchr(s, c, len) == byte_memchr(s, c, len), "memchr", i);
+        char expected[MAX_NAME_LEN];
+        byte_strcpy(expected, s);
+        kernel_strcpy(scratch, s);
+        check(byte_strcmp(scratch, expected), "strcpy", i);
+        byte_strcpy(scratch, "/home/");
+        kernel_strcat(scratch, s);
+        check(byte_strlen(scratch) == len + 6, "strcat", i);
+    }
+
+    printf("%s (%zu-%zu chars):  old          new\n",
+           workload->name, workload->min_len, workload->max_len);
+    double old_ns, new_ns;
+
+    TIME_CALLS(old_ns, sink += byte_strlen(strings[i].text));
+    TIME_CALLS(new_ns, sink += kernel_strlen(strings[i].text));
+    report("strlen", old_ns, new_ns);
+
+    TIME_CALLS(old_ns, sink += byte_strcmp(strings[i].text, copies[i].text));
+    TIME_CALLS(new_ns, sink += kernel_strcmp(strings[i].text, copies[i].text));
+    report("strcmp", old_ns, new_ns);
+
+    TIME_CALLS(old_ns, sink += byte_strncmp(strings[i].text, copies[i].text, strings[i].len));
+    TIME_CALLS(new_ns, sink += kernel_strncmp(strings[i].text, copies[i].text, strings[i].len));
+    report("strncmp", old_ns, new_ns);
+
+    // a character that is not there, so the whole string is scanned
+    TIME_CALLS(old_ns, sink += (size_t)byte_strchr(strings[i].text, '#'));
+    TIME_CALLS(new_ns, sink += (size_t)kernel_strchr(strings[i].text, '#'));
+    report("strchr", old_ns, new_ns);
+
+    TIME_CALLS(old_ns, sink += (size_t)byte_memchr(strings[i].text, '#', strings[i].len));
+    TIME_CALLS(new_ns, sink += (size_t)kernel_memchr(strings[i].text, '#', strings[i].len));
+    report("memchr", old_ns, new_ns);
+
+    TIME_CALLS(old_ns, byte_strcpy(scratch, strings[i].text));
+    TIME_CALLS(new_ns, kernel_strcpy(scratch, strings[i].text));
+    report("strcpy", old_ns, new_ns);
+
+    // append to a directory path, cutting it back each time
+    byte_strcpy(scratch, "/home/");
+    TIME_CALLS(old_ns, (scratch[6] = '\0', byte_strcat(scratch, strings[i].text)));
+    TIME_CALLS(new_ns, (scratch[6] = '\0', kernel_strcat(scratch, strings[i].text)));
+    report("strcat", old_ns, new_ns);
+}
+
+int main(void) {
+    srand(1);
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        run_workload(&workloads[i]);
+    }
+    if (mismatches) {
+        printf("mismatches: %zu\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
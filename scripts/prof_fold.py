@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+# MooseOS Profile folder
+# Copyright (c) 2025 Ethan Zhang
+# Licensed under the MIT license. See license file for details
+#
+# Turns the output of the terminal's `prof dump` command into folded
+# stacks, one "outer;...;inner count" line per distinct stack, which
+# flamegraph.pl, inferno and speedscope all read. Addresses are looked
+# up in the kernel ELF's symbol table with nm. Feed it the captured
+# serial log as it is: lines without the "[PROF] " prefix are skipped.
+#
+# Stacks are only deeper than one function in a kernel built with
+# `make PROF_FRAMES=1`.
+#
+# Usage: prof_fold.py [--elf bin/MooseOS.elf] [--top N] [serial.log] [-o out.folded]
+
+import argparse
+import bisect
+import collections
+import subprocess
+import sys
+
+PROF_PREFIX = "[PROF] "
+SYMBOL_TYPES = "tTwW"  # code symbols in nm's output
+
+
+def parse(lines):
+    """@return ({header key: value}, [(count, [pc, return address, ...])])"""
+    header = {}
+    samples = []
+    for line in lines:
+        start = line.find(PROF_PREFIX)
+        if start < 0:
+            continue
+        fields = line[start + len(PROF_PREFIX):].split()
+        if not fields:
+            continue
+        if fields[0] == "begin":
+            # a later dump replaces an earlier one in the same log
+            samples = []
+            header = dict(field.partition("=")[::2] for field in fields[1:])
+        elif fields[0] == "s" and len(fields) >= 3:
+            samples.append((int(fields[1]), [int(pc, 16) for pc in fields[2:]]))
+    return header, samples
+
+
+class Symbols:
+    def __init__(self, elf, nm):
+        try:
+            output = subprocess.run([nm, "-n", "--defined-only", elf], check=True,
+                                    capture_output=True, text=True).stdout
+        except (OSError, subprocess.CalledProcessError) as error:
+            sys.exit("prof_fold: cannot read symbols from %s: %s" % (elf, error))
+        self.addresses = []
+        self.names = []
+        for line in output.splitlines():
+            fields = line.split()
+            if len(fields) == 3 and fields[1] in SYMBOL_TYPES:
+                self.addresses.append(int(fields[0], 16))
+                self.names.append(fields[2])
+        if not self.addresses:
+            sys.exit("prof_fold: %s has no code symbols" % elf)
+
+    def lookup(self, address):
+        index = bisect.bisect_right(self.addresses, address) - 1
+        if index < 0:
+            return "0x%08x" % address
+        return self.names[index]
+
+
+def fold(samples, symbols):
+    stacks = collections.Counter()
+    for count, pcs in samples:
+        # return addresses point after the call, step back into it
+        frames = [symbols.lookup(pcs[0])] + [symbols.lookup(pc - 1) for pc in pcs[1:]]
+        stacks[";".join(reversed(frames))] += count
+    return stacks
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MooseOS profile dump to folded stacks")
+    parser.add_argument("input", nargs="?", help="captured serial log, stdin if omitted")
+    parser.add_argument("-o", "--output", help="folded stacks to write, stdout if omitted")
+    parser.add_argument("--elf", default="bin/MooseOS.elf", help="kernel the samples came from")
+    parser.add_argument("--nm", default="nm", help="nm to use, e.g. i386-elf-nm")
+    parser.add_argument("--top", type=int, default=0,
+                        help="also print the N functions with the most samples to stderr")
+    args = parser.parse_args()
+
+    if args.input:
+        with open(args.input, errors="replace") as f:
+            header, samples = parse(f)
+    else:
+        header, samples = parse(sys.stdin)
+    if not samples:
+        sys.exit("prof_fold: no profile samples found")
+    if header.get("dropped", "0") != "0":
+        print("prof_fold: %s samples were dropped, the buffer filled up" % header["dropped"],
+              file=sys.stderr)
+
+    stacks = fold(samples, Symbols(args.elf, args.nm))
+    out = open(args.output, "w") if args.output else sys.stdout
+    for stack, count in sorted(stacks.items()):
+        out.write("%s %d\n" % (stack, count))
+    if args.output:
+        out.close()
+
+    if args.top:
+        total = sum(stacks.values())
+        self_counts = collections.Counter()
+        for stack, count in stacks.items():
+            self_counts[stack.rsplit(";", 1)[-1]] += count
+        print("%d samples at %s Hz" % (total, header.get("hz", "?")), file=sys.stderr)
+        for name, count in self_counts.most_common(args.top):
+            print("%6.2f%% %7d  %s" % (100.0 * count / total, count, name), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+# MooseOS Trace converter
+# Copyright (c) 2025 Ethan Zhang
+# Licensed under the MIT license. See license file for details
+#
+# Turns the output of the terminal's `trace dump` command into Chrome's
+# trace event JSON, which chrome://tracing and ui.perfetto.dev open.
+# Feed it the captured serial log as it is: lines without the "[TRACE] "
+# prefix are skipped.
+#
+# Timer interrupts go on their own track. Task switches become one
+# "task N" slice per stretch of running time, and disk and filesystem
+# events nest inside the task that was running.
+#
+# Usage: trace_to_chrome.py [--tsc-mhz N] [serial.log] [-o trace.json]
+
+import argparse
+import json
+import sys
+
+TRACE_PREFIX = "[TRACE] "
+IRQ_TID = 1
+TASK_TID_BASE = 100  # task n is drawn on thread TASK_TID_BASE + n
+BOOT_TID = TASK_TID_BASE - 1  # before the first task switch
+
+
+def parse(lines):
+    """@return (tsc_khz, {event id: name}, [(tsc, event, phase, arg0, arg1)])"""
+    tsc_khz = 0
+    names = {}
+    records = []
+    for line in lines:
+        start = line.find(TRACE_PREFIX)
+        if start < 0:
+            continue
+        fields = line[start + len(TRACE_PREFIX):].split()
+        if not fields:
+            continue
+        if fields[0] == "begin":
+            # a later dump replaces an earlier one in the same log
+            records = []
+            for field in fields[1:]:
+                key, _, value = field.partition("=")
+                if key == "tsc_khz":
+                    tsc_khz = int(value)
+        elif fields[0] == "event" and len(fields) >= 3:
+            names[int(fields[1])] = fields[2]
+        elif fields[0] == "r" and len(fields) == 7:
+            tsc = (int(fields[1], 16) << 32) | int(fields[2], 16)
+            records.append((tsc, int(fields[3]), fields[4],
+                            int(fields[5], 16), int(fields[6], 16)))
+    return tsc_khz, names, records
+
+
+def convert(tsc_khz, names, records):
+    events = []
+    if not records:
+        return events
+    first_tsc = records[0][0]
+    cycles_per_us = tsc_khz / 1000.0
+
+    def ts(tsc):
+        return (tsc - first_tsc) / cycles_per_us
+
+    open_slices = {}  # tid -> names of slices begun and not yet ended
+    running = BOOT_TID
+
+    def begin(tid, name, time, args):
+        open_slices.setdefault(tid, []).append(name)
+        events.append({"name": name, "ph": "B", "ts": time, "pid": 0, "tid": tid, "args": args})
+
+    def end(tid, name, time, args):
+        stack = open_slices.get(tid, [])
+        # the ring may have overwritten the begin, drop the end then
+        if name not in stack:
+            return
+        while stack:
+            top = stack.pop()
+            events.append({"name": top, "ph": "E", "ts": time, "pid": 0, "tid": tid,
+                           "args": args if top == name else {}})
+            if top == name:
+                break
+
+    for tsc, event, phase, arg0, arg1 in records:
+        name = names.get(event, "event_%d" % event)
+        time = ts(tsc)
+        if name == "task_switch":
+            end(running, "task %d" % (running - TASK_TID_BASE), time, {})
+            running = TASK_TID_BASE + arg1
+            begin(running, "task %d" % arg1, time, {"from": arg0})
+            continue
+
+        tid = IRQ_TID if name == "timer_irq" else running
+        args = {"arg0": arg0, "arg1": arg1}
+        if phase == "B":
+            begin(tid, name, time, args)
+        elif phase == "E":
+            end(tid, name, time, args)
+        else:
+            events.append({"name": name, "ph": "i", "s": "t", "ts": time,
+                           "pid": 0, "tid": tid, "args": args})
+
+    # close whatever was still running when the dump was taken
+    last = ts(records[-1][0])
+    for tid, stack in open_slices.items():
+        while stack:
+            events.append({"name": stack.pop(), "ph": "E", "ts": last, "pid": 0, "tid": tid})
+
+    threads = {IRQ_TID: "interrupts", BOOT_TID: "boot"}
+    for tid in open_slices:
+        threads.setdefault(tid, "task %d" % (tid - TASK_TID_BASE))
+    for tid, thread_name in threads.items():
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tid,
+                       "args": {"name": thread_name}})
+    events.append({"name": "process_name", "ph": "M", "pid": 0,
+                   "args": {"name": "MooseOS"}})
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MooseOS trace dump to Chrome trace JSON")
+    parser.add_argument("input", nargs="?", help="captured serial log, stdin if omitted")
+    parser.add_argument("-o", "--output", help="JSON file to write, stdout if omitted")
+    parser.add_argument("--tsc-mhz", type=float,
+                        help="TSC frequency, overrides the one in the dump")
+    args = parser.parse_args()
+
+    if args.input:
+        with open(args.input, errors="replace") as f:
+            tsc_khz, names, records = parse(f)
+    else:
+        tsc_khz, names, records = parse(sys.stdin)
+
+    if args.tsc_mhz:
+        tsc_khz = int(args.tsc_mhz * 1000)
+    if not tsc_khz:
+        tsc_khz = 1000000
+        print("trace_to_chrome: the dump has no TSC frequency, assuming 1 GHz "
+              "(pass --tsc-mhz)", file=sys.stderr)
+    if not records:
+        print("trace_to_chrome: no trace records found", file=sys.stderr)
+
+    trace = {"traceEvents": convert(tsc_khz, names, records), "displayTimeUnit": "ns"}
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+        sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -8,6 +8,14 @@
 #define CPUID_H
 
 #include <stdint.h>
+#include <stdbool.h>
+
+// CPUID leaf 1 EDX feature bits
+#define CPUID_EDX_FXSR  (1 << 24)
+#define CPUID_EDX_SSE   (1 << 25)
+#define CPUID_EDX_SSE2  (1 << 26)
+
 void cpuid(uint32_t code, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d);
+bool cpu_enable_sse(void);
 
 #endif // CPUID_H
\ No newline at end of file
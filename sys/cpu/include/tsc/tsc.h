@@ -0,0 +1,33 @@
+/*
+    MooseOS Time Stamp Counter
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef TSC_H
+#define TSC_H
+
+#include <stdint.h>
+
+/**
+ * @return CPU cycles since reset
+ */
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * divide a 64 bit value by a 32 bit one without libgcc
+ * @note the quotient must fit in 32 bits
+ */
+static inline uint32_t div64_32(uint64_t dividend, uint32_t divisor) {
+    uint32_t quotient, remainder;
+    asm("divl %4"
+        : "=a"(quotient), "=d"(remainder)
+        : "a"((uint32_t)dividend), "d"((uint32_t)(dividend >> 32)), "rm"(divisor));
+    return quotient;
+}
+
+#endif // TSC_H
@@ -7,4 +7,37 @@
 
 void cpuid(uint32_t code, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
     asm volatile("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(code));
-}
\ No newline at end of file
+}
+// control register bits
+#define CR0_MP          (1 << 1)
+#define CR0_EM          (1 << 2)
+#define CR4_OSFXSR      (1 << 9)
+#define CR4_OSXMMEXCPT  (1 << 10)
+
+/**
+ * let the kernel run SSE instructions if the CPU has SSE2
+ * @return true if SSE2 instructions can be used
+ * @note nothing saves the XMM registers on a task switch or interrupt,
+ *       code using them must not yield and must keep interrupts off
+ */
+bool cpu_enable_sse(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax < 1) {
+        return false;
+    }
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_FXSR) || !(edx & CPUID_EDX_SSE) || !(edx & CPUID_EDX_SSE2)) {
+        return false;
+    }
+
+    uint32_t cr0, cr4;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~CR0_EM; // no x87 emulation
+    cr0 |= CR0_MP;
+    asm volatile("mov %0, %%cr0" : : "r"(cr0));
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    asm volatile("mov %0, %%cr4" : : "r"(cr4));
+    return true;
+}
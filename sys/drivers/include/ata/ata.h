@@ -16,6 +16,11 @@
 #define ATA_PRIMARY_CTRL_BASE   0x3F6
 #define ATA_SECONDARY_CTRL_BASE 0x376
 
+// polling, the drive gets ATA_POLL_TIMEOUT * ATA_POLL_DELAY_US (1s) to respond
+#define ATA_POLL_TIMEOUT        10000
+#define ATA_POLL_DELAY_US       100
+#define ATA_SETTLE_US           1       // after register writes, the spec asks for 400ns
+
 // ATA registers
 #define ATA_REG_DATA       0x00
 #define ATA_REG_ERROR      0x01
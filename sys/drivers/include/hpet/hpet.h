@@ -0,0 +1,29 @@
+/*
+    MooseOS HPET driver
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef HPET_H
+#define HPET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// register offsets from the base address
+#define HPET_CAPABILITIES    0x000 // period in the high half
+#define HPET_PERIOD          0x004
+#define HPET_CONFIG          0x010
+#define HPET_COUNTER         0x0F0
+#define HPET_COUNTER_HIGH    0x0F4
+#define HPET_REGISTERS_SIZE  0x400
+
+#define HPET_CAP_64BIT       (1 << 13) // main counter is 64 bits wide
+#define HPET_CONFIG_ENABLE   0x1
+
+#define HPET_MAX_PERIOD_FS   100000000 // 10 MHz, the slowest the spec allows
+
+bool hpet_init(void);
+uint64_t hpet_read(void);
+uint32_t hpet_period_fs(void);
+
+#endif // HPET_H
@@ -38,23 +38,32 @@
 #define PIT_BASE_FREQUENCY   1193182  // 1.193182 MHz base frequency
 #define PIT_TIMER_FREQUENCY  1000     // 1000 Hz (1ms intervals)
 #define PIT_TIMER_DIVISOR    (PIT_BASE_FREQUENCY / PIT_TIMER_FREQUENCY)
+#define PIT_ONESHOT_MAX_US   54925    // the longest a 16 bit count lasts
 
 // timer interrupt vector (IRQ0)
 #define TIMER_IRQ            0
 
+// the interrupted state, as the assembly stub leaves it on the stack
+typedef struct {
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax; // pusha
+    uint32_t eip, cs, eflags;                        // pushed by the CPU
+} timer_frame;
+
 // global timer variables
 extern volatile uint32_t system_ticks;
 extern volatile uint32_t seconds_since_boot;
-
-// external function declarations
-extern void kernel_update_time(void);
-extern void task_tick(void);
+extern volatile uint32_t system_ms;
 
 // function declarations
 void pit_init(uint32_t frequency);
 void pit_set_frequency(uint32_t frequency);
+uint32_t pit_get_frequency(void);
+void pit_oneshot(uint32_t us);
+void pit_resume_tick(uint64_t slept_ns);
 uint32_t pit_get_ticks(void);
+uint32_t pit_get_ms(void);
 uint32_t pit_get_seconds(void);
-void timer_interrupt_handler(void);
+void timer_interrupt_handler(const timer_frame *frame);
 
 #endif // PIT_H
\ No newline at end of file
@@ -0,0 +1,58 @@
+/*
+    MooseOS 16550 UART driver
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// COM1
+#define SERIAL_PORT         0x3F8
+#define SERIAL_IRQ          4
+#define SERIAL_DEFAULT_BAUD 115200
+#define SERIAL_BASE_BAUD    115200 // UART clock / 16, divisor 1
+
+// register offsets from SERIAL_PORT
+#define SERIAL_DATA         0 // THR on write, RBR on read, divisor low with DLAB
+#define SERIAL_IER          1 // interrupt enable, divisor high with DLAB
+#define SERIAL_IIR          2 // interrupt identification on read
+#define SERIAL_FCR          2 // FIFO control on write
+#define SERIAL_LCR          3
+#define SERIAL_MCR          4
+#define SERIAL_LSR          5
+#define SERIAL_MSR          6
+
+// interrupt enable bits
+#define SERIAL_IER_RX       0x01 // received data available
+#define SERIAL_IER_THRE     0x02 // transmit holding register empty
+#define SERIAL_IER_LINE     0x04 // line status
+
+// line status bits
+#define SERIAL_LSR_DATA     0x01
+#define SERIAL_LSR_OVERRUN  0x02
+#define SERIAL_LSR_THRE     0x20
+
+#define SERIAL_FIFO_SIZE    16
+#define SERIAL_TX_RING_SIZE 4096 // power of two
+#define SERIAL_RX_RING_SIZE 256  // power of two
+
+typedef struct {
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint32_t rx_dropped;      // ring full or UART overrun
+    uint32_t tx_interrupts;
+    bool fifo;                // 16550A FIFOs found and enabled
+} serial_stats;
+
+void serial_init(uint32_t baud);
+size_t serial_write(const char *data, size_t len);
+void serial_write_sync(const char *data, size_t len);
+void serial_write_char(char c);
+size_t serial_read(char *buffer, size_t size);
+void serial_get_stats(serial_stats *stats);
+
+#endif // SERIAL_H
@@ -8,6 +8,8 @@
 #include "ata/ata.h"
 #include "libc/lib.h"
 #include "print/debug.h"
+#include "trace/trace.h"
+#include "clocksource/clocksource.h"
 #include <stdio.h>
 
 // ATA device information
@@ -31,26 +33,14 @@ void ata_write_command(uint16_t base_io, uint8_t cmd) {
 }
 
 /**
- * simple delay
+ * wait between status polls, the poll loops give up after
+ * ATA_POLL_TIMEOUT of these, about a second
  */
 void simple_delay(void) {
-    for (int i = 0; i < 100; i++) {
-        volatile uint8_t dummy = inb(0x80); // Unused port
-        /** 
-         * @note this code assumes 0x80 is unused
-         * if you are having trouble with using 0x80, please change this
-        */
-        (void)dummy;
-    }
+    udelay(ATA_POLL_DELAY_US);
 }
 
-/**
- * read a sector from disk
- * @param drive drive number (0-3)
- * @param lba logical block address
- * @param buffer buffer to store data
- */
-int disk_read_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
+static int ata_read_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     if (drive >= 4 || !ata_devices[drive].exists) {
         debugf("[ATA] Invalid drive\n"); // tell Ethan/user the code messed up
         return -1; // invalid drive
@@ -60,7 +50,7 @@ int disk_read_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     uint16_t base_io = 0x1F0;
     
     // wait for controller to be ready
-    int timeout = 10000;
+    int timeout = ATA_POLL_TIMEOUT;
     while ((inb(base_io + ATA_REG_STATUS) & ATA_SR_BSY) && timeout--) {
         simple_delay();
     }
@@ -71,20 +61,20 @@ int disk_read_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     
     // select drive 0 (master) with LBA mode
     outb(base_io + 6, 0xE0 | ((lba >> 24) & 0x0F));
-    simple_delay();
+    udelay(ATA_SETTLE_US);
     
     // set up the command
     outb(base_io + 2, 1);                    // Sector count = 1
     outb(base_io + 3, lba & 0xFF);           // LBA[7:0]
     outb(base_io + 4, (lba >> 8) & 0xFF);    // LBA[15:8]
     outb(base_io + 5, (lba >> 16) & 0xFF);   // LBA[23:16]
-    simple_delay();
+    udelay(ATA_SETTLE_US);
     
     // send READ SECTORS command (0x20)
     outb(base_io + 7, 0x20);
     
     // wait for command to complete
-    timeout = 10000;
+    timeout = ATA_POLL_TIMEOUT;
     uint8_t status;
     while (timeout--) {
         status = inb(base_io + ATA_REG_STATUS);
@@ -132,9 +122,7 @@ void ata_soft_reset(uint16_t ctrl_io) {
     outb(ctrl_io + ATA_REG_CONTROL, 4); // set SRST bit
 
     // wait 5 microseconds
-    for (int i = 0; i < 1000; i++) {
-        inb(ctrl_io);
-    }
+    udelay(5);
 
     outb(ctrl_io + ATA_REG_CONTROL, 0); // clear SRST bit
 }
@@ -143,7 +131,7 @@ void ata_soft_reset(uint16_t ctrl_io) {
  * wait for drive to be ready
  */
 int ata_wait_ready(uint16_t base_io) {
-    int timeout = 10000;
+    int timeout = ATA_POLL_TIMEOUT;
     uint8_t status;
     
     while (timeout--) {
@@ -165,7 +153,7 @@ int ata_wait_ready(uint16_t base_io) {
  * wait for data request ready
  */
 int ata_wait_drq(uint16_t base_io) {
-    int timeout = 10000;
+    int timeout = ATA_POLL_TIMEOUT;
     uint8_t status;
     
     while (timeout--) {
@@ -256,10 +244,7 @@ void disk_init(void) {
     strcpy(ata_devices[0].model, "QEMU");
 }
 
-/**
- * write a single sector to disk
- */
-int disk_write_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
+static int ata_write_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     if (drive >= 4 || !ata_devices[drive].exists) {
         debugf("[ATA] Invalid drive\n");
         return -1; // Invalid drive
@@ -269,7 +254,7 @@ int disk_write_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     uint16_t base_io = 0x1F0;
 
     // wait for controller to be ready (BSY clear)
-    int timeout = 10000;
+    int timeout = ATA_POLL_TIMEOUT;
     while ((inb(base_io + ATA_REG_STATUS) & ATA_SR_BSY) && timeout--) {
         simple_delay();
     }
@@ -280,20 +265,20 @@ int disk_write_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     
     // select drive 0 (master) with LBA mode
     outb(base_io + 6, 0xE0 | ((lba >> 24) & 0x0F));
-    simple_delay();
+    udelay(ATA_SETTLE_US);
     
     // set up the command
     outb(base_io + 2, 1);                    // sector count = 1
     outb(base_io + 3, lba & 0xFF);           // LBA[7:0]
     outb(base_io + 4, (lba >> 8) & 0xFF);    // LBA[15:8]
     outb(base_io + 5, (lba >> 16) & 0xFF);   // LBA[23:16]
-    simple_delay();
+    udelay(ATA_SETTLE_US);
     
     // send WRITE SECTORS command (0x30)
     outb(base_io + 7, 0x30);
 
     // wait for command to be ready for data
-    timeout = 10000;
+    timeout = ATA_POLL_TIMEOUT;
     uint8_t status;
     while (timeout--) {
         status = inb(base_io + ATA_REG_STATUS);
@@ -320,7 +305,7 @@ int disk_write_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     }
     
     // wait for write to complete (BSY clear)
-    timeout = 10000;
+    timeout = ATA_POLL_TIMEOUT;
     while ((inb(base_io + ATA_REG_STATUS) & ATA_SR_BSY) && timeout--) {
         simple_delay();
     }
@@ -340,7 +325,7 @@ int disk_write_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
     outb(base_io + ATA_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
 
     // wait for flush to complete
-    timeout = 10000;
+    timeout = ATA_POLL_TIMEOUT;
     while ((inb(base_io + ATA_REG_STATUS) & ATA_SR_BSY) && timeout--) {
         simple_delay();
     }
@@ -397,7 +382,7 @@ int disk_force_flush(uint8_t drive) {
     //  standard cache flush
     outb(base_io + ATA_REG_COMMAND, ATA_CMD_CACHE_FLUSH);
     
-    int timeout = 10000;
+    int timeout = ATA_POLL_TIMEOUT;
     while ((inb(base_io + ATA_REG_STATUS) & ATA_SR_BSY) && timeout--) {
         simple_delay();
     }
@@ -418,3 +403,26 @@ int disk_force_flush(uint8_t drive) {
 
     return 0; // success! except that this code damages your ATA drive :(
 }
+
+/**
+ * read a sector from disk
+ * @param drive drive number (0-3)
+ * @param lba logical block address
+ * @param buffer buffer to store data
+ */
+int disk_read_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
+    TRACE_BEGIN(TRACE_DISK_READ, lba, 0);
+    int result = ata_read_sector(drive, lba, buffer);
+    TRACE_END(TRACE_DISK_READ, lba, (uint32_t)result);
+    return result;
+}
+
+/**
+ * write a single sector to disk
+ */
+int disk_write_sector(uint8_t drive, uint32_t lba, uint8_t *buffer) {
+    TRACE_BEGIN(TRACE_DISK_WRITE, lba, 0);
+    int result = ata_write_sector(drive, lba, buffer);
+    TRACE_END(TRACE_DISK_WRITE, lba, (uint32_t)result);
+    return result;
+}
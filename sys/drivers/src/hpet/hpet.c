@@ -0,0 +1,108 @@
+/*
+    MooseOS HPET driver
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Only the main counter is used, as a clock. The comparators
+    (timers) are left alone and the PIT keeps raising IRQ0.
+*/
+
+#include "hpet/hpet.h"
+#include "acpi/acpi.h"
+#include "paging/paging.h"
+#include "io/io.h"
+#include "print/debug.h"
+
+// the ACPI table describing the first HPET
+typedef struct {
+    acpi_header header;
+    uint32_t hardware_id;
+    acpi_address base;
+    uint8_t number;
+    uint16_t min_tick;
+    uint8_t page_protection;
+} __attribute__((packed)) acpi_hpet;
+
+static volatile uint8_t *registers = NULL;
+static uint32_t period_fs = 0;
+static bool wide_counter = false;
+
+// a 32 bit counter is widened here, see hpet_read
+static uint32_t last_low = 0;
+static uint32_t high_word = 0;
+
+static inline uint32_t read_register(uint32_t offset) {
+    return *(volatile uint32_t *)(registers + offset);
+}
+
+static inline void write_register(uint32_t offset, uint32_t value) {
+    *(volatile uint32_t *)(registers + offset) = value;
+}
+
+/**
+ * find the HPET through ACPI and start its main counter
+ * @return true if the counter is running
+ * @note needs paging, the registers are mapped uncached
+ */
+bool hpet_init(void) {
+    const acpi_hpet *table = (const acpi_hpet *)acpi_find_table("HPET");
+    if (!table) {
+        return false;
+    }
+    if (table->base.address_space != ACPI_SPACE_MEMORY || table->base.address >> 32) {
+        debugf("[HPET] Registers are out of reach\n");
+        return false;
+    }
+
+    uint32_t base = (uint32_t)table->base.address;
+    if (!paging_map_identity(base, HPET_REGISTERS_SIZE, PAGE_NO_CACHE)) {
+        debugf("[HPET] Could not map registers\n");
+        return false;
+    }
+    registers = (volatile uint8_t *)base;
+
+    period_fs = read_register(HPET_PERIOD);
+    if (period_fs == 0 || period_fs > HPET_MAX_PERIOD_FS) {
+        debugf("[HPET] Bad counter period\n");
+        registers = NULL;
+        return false;
+    }
+    wide_counter = read_register(HPET_CAPABILITIES) & HPET_CAP_64BIT;
+
+    write_register(HPET_CONFIG, read_register(HPET_CONFIG) | HPET_CONFIG_ENABLE);
+    return true;
+}
+
+/**
+ * @return main counter ticks, hpet_period_fs femtoseconds each
+ * @note a 32 bit counter must be read at least once per wrap, minutes
+ *       at the slowest period, for the widened value to stay right
+ */
+uint64_t hpet_read(void) {
+    if (wide_counter) {
+        // the halves cannot be read together, retry if the low half wrapped in between
+        uint32_t high, low;
+        do {
+            high = read_register(HPET_COUNTER_HIGH);
+            low = read_register(HPET_COUNTER);
+        } while (high != read_register(HPET_COUNTER_HIGH));
+        return ((uint64_t)high << 32) | low;
+    }
+
+    unsigned long flags = irq_save();
+    uint32_t low = read_register(HPET_COUNTER);
+    if (low < last_low) {
+        high_word++;
+    }
+    last_low = low;
+    uint64_t value = ((uint64_t)high_word << 32) | low;
+    irq_restore(flags);
+    return value;
+}
+
+/**
+ * @return length of a counter tick in femtoseconds, 0 without an HPET
+ */
+uint32_t hpet_period_fs(void) {
+    return period_fs;
+}
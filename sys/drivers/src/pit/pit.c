@@ -6,19 +6,46 @@
 
 #include "pit/pit.h"
 #include "idt/idt.h"
-#include "task/task.h"
+#include "io/io.h"
+#include "prof/prof.h"
+#include "trace/trace.h"
+#include "tsc/tsc.h"
+
+#define PIC1_DATA 0x21
 
 // global timer variables
 volatile uint32_t system_ticks = 0;
 volatile uint32_t seconds_since_boot = 0;
+volatile uint32_t system_ms = 0; // counts milliseconds at any tick rate
 
 static uint32_t ticks_per_second = PIT_TIMER_FREQUENCY;
+static uint32_t second_ticks = 0; // ticks into the current second
+static uint16_t tick_divisor = PIT_TIMER_DIVISOR;
+static uint32_t tick_ns = 1000000000 / PIT_TIMER_FREQUENCY;
+static uint32_t slept_remainder_ns = 0; // sleep too short to make a whole tick yet
+static uint32_t ms_remainder_ns = 0;    // time since system_ms last moved
+static volatile bool oneshot = false;    // the periodic tick is stopped
+
+// move system_ms on by elapsed time, called with interrupts off
+static void advance_ms(uint64_t ns) {
+    ns += ms_remainder_ns;
+    uint32_t ms = div64_32(ns, 1000000);
+    ms_remainder_ns = (uint32_t)(ns - (uint64_t)ms * 1000000);
+    system_ms += ms;
+}
+
+// channel 0, access mode: lobyte/hibyte, binary mode
+static void pit_write_channel_0(uint8_t mode, uint16_t count) {
+    outb(PIT_COMMAND, PIT_CHANNEL_0_SEL | PIT_ACCESS_LOHI | mode | PIT_BINARY);
+    outb(PIT_CHANNEL_0, count & 0xFF); // low byte
+    outb(PIT_CHANNEL_0, (count >> 8) & 0xFF); // high byte
+}
 
 /**
- * initialize the PIT with the specified frequency
+ * program channel 0, leaving the tick counters alone
  * @param frequency the desired timer frequency in Hz
  */
-void pit_init(uint32_t frequency) {
+static void pit_program(uint32_t frequency) {
     // calculate divisor
     uint32_t divisor = PIT_BASE_FREQUENCY / frequency;
     
@@ -27,28 +54,93 @@ void pit_init(uint32_t frequency) {
         divisor = 0xFFFF;
     }
     
+    unsigned long flags = irq_save();
+    // mode 3 (square wave)
+    pit_write_channel_0(PIT_MODE_3, divisor);
+    tick_divisor = divisor;
     ticks_per_second = PIT_BASE_FREQUENCY / divisor;
-    
-    // send command to PIT
-    // channel 0, access mode: lobyte/hibyte, mode 3 (square wave), binary mode
-    uint8_t command = PIT_CHANNEL_0_SEL | PIT_ACCESS_LOHI | PIT_MODE_3 | PIT_BINARY;
-    outb(PIT_COMMAND, command);
-    
-    outb(PIT_CHANNEL_0, divisor & 0xFF); // low byte
-    outb(PIT_CHANNEL_0, (divisor >> 8) & 0xFF); // high byte
+    tick_ns = 1000000000 / ticks_per_second;
+    second_ticks = 0;
+    oneshot = false;
+    irq_restore(flags);
+}
+
+/**
+ * initialize the PIT with the specified frequency and start its interrupt
+ * @param frequency the desired timer frequency in Hz
+ * @note call after keyboard_init, which rewrites the PIC masks
+ */
+void pit_init(uint32_t frequency) {
+    pit_program(frequency);
 
     // reset tick counters
     system_ticks = 0;
     seconds_since_boot = 0;
+    system_ms = 0;
+
+    outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << TIMER_IRQ));
 }
 
 /**
  * set a new frequency for the PIT
  * @param frequency the new frequency in Hz
+ * @note the tick counters keep counting, ticks just get shorter or longer,
+ *       system_ms keeps its rate
  */
 void pit_set_frequency(uint32_t frequency) {
-    // reinitialize PIT with new frequency
-    pit_init(frequency);
+    pit_program(frequency);
+}
+
+/**
+ * stop the periodic tick and interrupt once after a delay instead
+ * @param us microseconds until the interrupt, at most PIT_ONESHOT_MAX_US
+ * @note the tick counters stand still until pit_resume_tick
+ */
+void pit_oneshot(uint32_t us) {
+    if (us > PIT_ONESHOT_MAX_US) {
+        us = PIT_ONESHOT_MAX_US;
+    }
+    uint32_t count = div64_32((uint64_t)us * PIT_BASE_FREQUENCY, 1000000);
+    if (count == 0) {
+        count = 1;
+    }
+
+    unsigned long flags = irq_save();
+    oneshot = true;
+    // mode 0 (interrupt on terminal count) fires once and stops
+    pit_write_channel_0(PIT_MODE_0, count);
+    irq_restore(flags);
+}
+
+/**
+ * restart the periodic tick after pit_oneshot
+ * @param slept_ns time since the tick stopped, added to the tick counters
+ */
+void pit_resume_tick(uint64_t slept_ns) {
+    unsigned long flags = irq_save();
+    if (oneshot) {
+        pit_write_channel_0(PIT_MODE_3, tick_divisor);
+        oneshot = false;
+        advance_ms(slept_ns);
+
+        slept_ns += slept_remainder_ns;
+        uint32_t ticks = div64_32(slept_ns, tick_ns);
+        slept_remainder_ns = (uint32_t)(slept_ns - (uint64_t)ticks * tick_ns);
+        system_ticks += ticks;
+        second_ticks += ticks;
+        while (second_ticks >= ticks_per_second) {
+            second_ticks -= ticks_per_second;
+            seconds_since_boot++;
+        }
+    }
+    irq_restore(flags);
+}
+
+/**
+ * @return timer interrupts per second
+ */
+uint32_t pit_get_frequency(void) {
+    return ticks_per_second;
 }
 
 /**
@@ -58,6 +150,13 @@ uint32_t pit_get_ticks(void) {
     return system_ticks;
 }
 
+/**
+ * @return milliseconds since boot, unlike the ticks whatever the frequency was
+ */
+uint32_t pit_get_ms(void) {
+    return system_ms;
+}
+
 /**
  * @return seconds since boot
  */
@@ -66,18 +165,27 @@ uint32_t pit_get_seconds(void) {
 }
 
 /**
- * timer interrupt handler
+ * timer interrupt handler, the assembly stub sends the end of interrupt
+ * @param frame the interrupted state
+ * @note the dock clock and task switching run from the main loop instead,
+ *       from here they would draw and switch stacks under whatever it was doing
  */
-void timer_interrupt_handler(void) {
-    system_ticks++;
-    
-    if (system_ticks % ticks_per_second == 0) {
-        seconds_since_boot++;
+void timer_interrupt_handler(const timer_frame *frame) {
+    TRACE_BEGIN(TRACE_TIMER_IRQ, system_ticks, 0);
+    // a one-shot is only a wake up, pit_resume_tick counts the time
+    if (!oneshot) {
+        system_ticks++;
+        ms_remainder_ns += tick_ns;
+        while (ms_remainder_ns >= 1000000) {
+            ms_remainder_ns -= 1000000;
+            system_ms++;
+        }
+        if (++second_ticks >= ticks_per_second) {
+            second_ticks = 0;
+            seconds_since_boot++;
+        }
     }
     
-    task_tick();
-    kernel_update_time();
-    
-    // signal end of interrupt to PIC
-    outb(0x20, 0x20);
-}
\ No newline at end of file
+    prof_sample(frame);
+    TRACE_END(TRACE_TIMER_IRQ, system_ticks, 0);
+}
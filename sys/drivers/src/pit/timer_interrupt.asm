@@ -21,8 +21,10 @@ timer_handler:
     mov fs, ax
     mov gs, ax
     
-    ; call the C timer handler
+    ; call the C timer handler with the saved state
+    push esp
     call timer_interrupt_handler
+    add esp, 4
 
     ; send End of Interrupt to PIC
     mov al, 0x20
@@ -0,0 +1,228 @@
+/*
+    MooseOS 16550 UART driver
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Transmit goes through a ring that the THRE interrupt drains,
+    up to a FIFO's worth of bytes per interrupt, so writers never wait
+    on the line. Received bytes are moved into a second ring by the
+    same interrupt. Each ring has one writer and one reader, and the
+    interrupt is one of them, so positions only need to be volatile.
+*/
+
+#include "serial/serial.h"
+#include "io/io.h"
+#include "idle/idle.h"
+
+#define PIC1_DATA       0x21
+#define EFLAGS_IF       0x200
+
+// interrupt identification
+#define IIR_NONE        0x01
+#define IIR_ID_MASK     0x0E
+#define IIR_LINE        0x06
+#define IIR_RX          0x04
+#define IIR_TIMEOUT     0x0C
+#define IIR_THRE        0x02
+#define IIR_FIFO_MASK   0xC0 // both set on a 16550A with FIFOs on
+
+static char tx_ring[SERIAL_TX_RING_SIZE];
+static volatile uint32_t tx_head = 0; // written by serial_write
+static volatile uint32_t tx_tail = 0; // written by the interrupt
+static char rx_ring[SERIAL_RX_RING_SIZE];
+static volatile uint32_t rx_head = 0; // written by the interrupt
+static volatile uint32_t rx_tail = 0; // written by serial_read
+
+static bool serial_ready = false;
+static uint32_t fifo_size = 1;
+static volatile uint8_t ier = 0;
+static serial_stats stats;
+
+static inline bool transmit_empty(void) {
+    return inb(SERIAL_PORT + SERIAL_LSR) & SERIAL_LSR_THRE;
+}
+
+/**
+ * move up to a FIFO's worth of bytes from the ring to the UART,
+ * the line must be known to be idle (THRE)
+ */
+static void transmit_batch(void) {
+    uint32_t count = 0;
+    while (count < fifo_size && tx_tail != tx_head) {
+        outb(SERIAL_PORT + SERIAL_DATA, (uint8_t)tx_ring[tx_tail % SERIAL_TX_RING_SIZE]);
+        tx_tail++;
+        count++;
+    }
+    stats.tx_bytes += count;
+}
+
+static void set_ier(uint8_t value) {
+    ier = value;
+    outb(SERIAL_PORT + SERIAL_IER, value);
+}
+
+/**
+ * set up COM1 with FIFOs and interrupts
+ * @param baud line speed, rounded to the nearest divisor of 115200
+ * @note call after keyboard_init, which rewrites the PIC masks
+ */
+void serial_init(uint32_t baud) {
+    if (baud == 0 || baud > SERIAL_BASE_BAUD) {
+        baud = SERIAL_DEFAULT_BAUD;
+    }
+    uint16_t divisor = (SERIAL_BASE_BAUD + baud / 2) / baud;
+
+    set_ier(0);
+    outb(SERIAL_PORT + SERIAL_LCR, 0x80); // DLAB to reach the divisor
+    outb(SERIAL_PORT + SERIAL_DATA, divisor & 0xFF);
+    outb(SERIAL_PORT + SERIAL_IER, divisor >> 8);
+    outb(SERIAL_PORT + SERIAL_LCR, 0x03); // 8 data bits, no parity, 1 stop bit
+
+    // enable and clear the FIFOs, receive interrupt at 14 bytes
+    outb(SERIAL_PORT + SERIAL_FCR, 0xC7);
+    if ((inb(SERIAL_PORT + SERIAL_IIR) & IIR_FIFO_MASK) == IIR_FIFO_MASK) {
+        fifo_size = SERIAL_FIFO_SIZE;
+        stats.fifo = true;
+    } else {
+        fifo_size = 1; // 8250/16450, or a 16550 with a broken FIFO
+        outb(SERIAL_PORT + SERIAL_FCR, 0);
+    }
+
+    // DTR, RTS and OUT2, which connects the interrupt line to the PIC
+    outb(SERIAL_PORT + SERIAL_MCR, 0x0B);
+    inb(SERIAL_PORT + SERIAL_LSR);
+    inb(SERIAL_PORT + SERIAL_DATA);
+    inb(SERIAL_PORT + SERIAL_MSR);
+
+    set_ier(SERIAL_IER_RX | SERIAL_IER_LINE);
+    outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << SERIAL_IRQ));
+    serial_ready = true;
+}
+
+/**
+ * queue bytes for sending without waiting
+ * @return number of bytes taken, fewer than len if the ring is full
+ * @note before serial_init or with interrupts off, bytes go straight
+ *       to the UART while it has room instead
+ */
+size_t serial_write(const char *data, size_t len) {
+    uint32_t flags;
+    asm volatile("pushf\n\tpop %0" : "=r"(flags));
+    if (!serial_ready || !(flags & EFLAGS_IF)) {
+        size_t sent = 0;
+        // nothing will drain the ring, so it has to be empty first
+        while (serial_ready && tx_tail != tx_head && transmit_empty()) {
+            transmit_batch();
+        }
+        if (tx_tail != tx_head) {
+            return 0;
+        }
+        while (sent < len && transmit_empty()) {
+            size_t batch = len - sent < fifo_size ? len - sent : fifo_size;
+            for (size_t i = 0; i < batch; i++) {
+                outb(SERIAL_PORT + SERIAL_DATA, (uint8_t)data[sent + i]);
+            }
+            sent += batch;
+        }
+        stats.tx_bytes += sent;
+        return sent;
+    }
+
+    size_t taken = 0;
+    while (taken < len && tx_head - tx_tail < SERIAL_TX_RING_SIZE) {
+        tx_ring[tx_head % SERIAL_TX_RING_SIZE] = data[taken];
+        tx_head++;
+        taken++;
+    }
+
+    // the THRE interrupt fires as soon as it is enabled on an idle line
+    if (taken && !(ier & SERIAL_IER_THRE)) {
+        flags = irq_save();
+        set_ier(ier | SERIAL_IER_THRE);
+        irq_restore(flags);
+    }
+    return taken;
+}
+
+/**
+ * send bytes, waiting on the line, for when interrupts cannot be relied on (panic)
+ */
+void serial_write_sync(const char *data, size_t len) {
+    unsigned long flags = irq_save();
+    while (tx_tail != tx_head) {
+        while (!transmit_empty());
+        transmit_batch();
+    }
+    for (size_t i = 0; i < len; i++) {
+        serial_write_char(data[i]);
+    }
+    stats.tx_bytes += len;
+    irq_restore(flags);
+}
+
+// write a single character to serial, waiting for the line
+void serial_write_char(char c) {
+    while (!transmit_empty());
+    outb(SERIAL_PORT + SERIAL_DATA, (uint8_t)c);
+}
+
+/**
+ * take received bytes
+ * @return number of bytes copied, 0 if nothing is waiting
+ */
+size_t serial_read(char *buffer, size_t size) {
+    size_t count = 0;
+    while (count < size && rx_tail != rx_head) {
+        buffer[count++] = rx_ring[rx_tail % SERIAL_RX_RING_SIZE];
+        rx_tail++;
+    }
+    return count;
+}
+
+void serial_get_stats(serial_stats *out) {
+    *out = stats;
+}
+
+static void receive(void) {
+    uint8_t lsr;
+    while ((lsr = inb(SERIAL_PORT + SERIAL_LSR)) & SERIAL_LSR_DATA) {
+        char c = (char)inb(SERIAL_PORT + SERIAL_DATA);
+        if (lsr & SERIAL_LSR_OVERRUN) {
+            stats.rx_dropped++;
+        }
+        if (rx_head - rx_tail < SERIAL_RX_RING_SIZE) {
+            rx_ring[rx_head % SERIAL_RX_RING_SIZE] = c;
+            rx_head++;
+            stats.rx_bytes++;
+        } else {
+            stats.rx_dropped++;
+        }
+    }
+}
+
+// called by assembly file
+void serial_handler_main(void) {
+    // received bytes, or room for more of the kernel log
+    idle_wake();
+    uint8_t iir;
+    while (!((iir = inb(SERIAL_PORT + SERIAL_IIR)) & IIR_NONE)) {
+        switch (iir & IIR_ID_MASK) {
+            case IIR_RX:
+            case IIR_TIMEOUT:
+            case IIR_LINE:
+                receive();
+                break;
+            case IIR_THRE:
+                stats.tx_interrupts++;
+                if (tx_tail == tx_head) {
+                    set_ier(ier & ~SERIAL_IER_THRE); // nothing left, stop asking
+                } else {
+                    transmit_batch();
+                }
+                break;
+            default:
+                inb(SERIAL_PORT + SERIAL_MSR); // modem status, not used
+                break;
+        }
+    }
+}
@@ -0,0 +1,41 @@
+global serial_handler
+extern serial_handler_main
+
+; COM1 (IRQ4)
+KERNEL_DATA_SEG equ 0x10
+
+serial_handler:
+    ; save all registers
+    pusha
+    
+    ; save segment registers
+    push ds
+    push es
+    push fs
+    push gs
+    
+    ; set up kernel data segments
+    mov ax, KERNEL_DATA_SEG
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    
+    ; call the C handler
+    call serial_handler_main
+
+    ; send End of Interrupt to PIC
+    mov al, 0x20
+    out 0x20, al
+    
+    ; restore segment registers
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    
+    ; restore all registers
+    popa
+
+    ; return from interrupt
+    iretd
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include "speaker/speaker.h"
 #include "io/io.h"
+#include "clocksource/clocksource.h"
 
 // internal state tracking variables
 static uint8_t speaker_initialized = 0;
@@ -126,19 +127,6 @@ uint8_t speaker_is_playing(void) {
     return speaker_playing;
 }
 
-/**
- * delay speaker
- * @param milliseconds approximate milliseconds to wait
- * 
- * @todo there's got to be a better way to delay this speaker
- */
-static void speaker_delay(uint32_t milliseconds) {
-    volatile uint32_t cycles = milliseconds * 100000;
-    for (volatile uint32_t i = 0; i < cycles; i++) {
-        asm volatile("nop");
-    }
-}
-
 /**
  * play a beep sound at the specified frequency for a duration
  * @param frequency Frequency in Hz
@@ -146,7 +134,7 @@ static void speaker_delay(uint32_t milliseconds) {
  */
 void speaker_beep(uint32_t frequency, uint32_t duration_ms) {
     speaker_play_tone(frequency);
-    speaker_delay(duration_ms);
+    mdelay(duration_ms);
     speaker_stop();
 }
 
@@ -163,14 +151,14 @@ void speaker_system_beep(void) {
 }
 void speaker_error_beep(void) {
     speaker_beep(200, 150);
-    speaker_delay(50);
+    mdelay(50);
     speaker_beep(200, 150);
-    speaker_delay(50);
+    mdelay(50);
     speaker_beep(200, 300);
 }
 void speaker_success_beep(void) {
     speaker_beep(1500, 100);
-    speaker_delay(50);
+    mdelay(50);
     speaker_beep(2000, 150);
 }
 
@@ -182,13 +170,13 @@ void speaker_startup_melody(void) {
 }
 void speaker_notification_beep(void) {
     speaker_beep(800, 100);
-    speaker_delay(100);
+    mdelay(100);
     speaker_beep(1200, 150);
 }
 void speaker_warning_beep(void) {
     for (int i = 0; i < 5; i++) {
         speaker_beep(400, 80);
-        speaker_delay(80);
+        mdelay(80);
     }
 }
 void speaker_test_scale(void) {
@@ -203,6 +191,6 @@ void speaker_test_scale(void) {
     
     for (int i = 0; i < 8; i++) {
         speaker_play_note(notes[i], 300);
-        speaker_delay(100);
+        mdelay(100);
     }
 }
@@ -100,6 +100,8 @@ typedef struct File {
             char* content;
             size_t content_size;    // actual content size
             size_t content_capacity; // allocated capacity
+            uint32_t disk_block;    // sector with a clean copy of the content, 0 if there is none
+            uint32_t pins;          // file_get_content users yet to call file_put_content
         } file;
         struct {
             struct File** children; // array of pointers
@@ -136,8 +138,13 @@ void filesystem_init(void);
 bool name_in_cwd(const char* name, file_node type);
 int set_file_content(File* file, const char* content);
 int set_file_content_binary(File* file, const char* data, size_t size);
+char* file_get_content(File* file);
+void file_put_content(File* file);
+size_t file_content_shrink(size_t wanted);
+void file_get_content_stats(uint32_t *evicted, uint32_t *reloaded);
 int add_child_to_dir(File* dir, File* child);
 int remove_child_from_dir(File* dir, File* child);
+bool file_tree_saveable(File *dir);
 int save_directory_recursive(File *dir, uint32_t dir_inode_num, uint32_t parent_inode);
 int load_directory_recursive(uint32_t inode_num, File* parent);
 
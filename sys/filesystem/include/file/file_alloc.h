@@ -6,9 +6,14 @@
 #ifndef FILE_ALLOC_H
 #define FILE_ALLOC_H
 #include "file.h"
+#include "slab/slab.h"
 
 // function declarations
 File* file_alloc();
 void file_free(File* file);
+File** children_alloc(int *capacity);
+File** children_realloc(File** children, int capacity, int new_capacity);
+void children_free(File** children, int capacity);
+int file_cache_get_stats(kmem_cache_stats *files, kmem_cache_stats *children);
 
 #endif // FILE_ALLOC_H
\ No newline at end of file
@@ -21,5 +21,6 @@ void filesystem_flush_cache();
 int filesystem_get_disk_info(char *info_buffer, int buffer_size);
 int filesystem_get_memory_stats(char *stats_buffer, int buffer_size);
 char* get_file_content(const char* filename);
+void put_file_content(const char* filename);
 
 #endif // FILESYSTEM_H
\ No newline at end of file
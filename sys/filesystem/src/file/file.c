@@ -34,6 +34,10 @@ uint8_t disk_buffer[SECTOR_SIZE];
 // cache
 file_superblock sb_cache;
 
+// clean content dropped under memory pressure, and read back later
+static uint32_t contents_evicted = 0;
+static uint32_t contents_reloaded = 0;
+
 /**
  * set file content
  */
@@ -45,13 +49,15 @@ int set_file_content(File* file, const char* content) {
     
     size_t new_size = strlen(content);
     
-    // free old content
+    // free old content, the copy on disk is stale from now on
     if (file->file.content) {
         kfree(file->file.content);
+        file->file.content = NULL;
     }
+    file->file.disk_block = 0;
     
     // allocate new content
-    file->file.content = (char*)kmalloc(new_size + 1);
+    file->file.content = (char*)kmalloc_tagged(new_size + 1, HEAP_TAG_FILESYSTEM);
     if (!file->file.content) {
         file->file.content_size = 0;
         file->file.content_capacity = 0;
@@ -84,13 +90,15 @@ int set_file_content_binary(File* file, const char* data, size_t size) {
         return -1;
     }
     
-    // free old content
+    // free old content, the copy on disk is stale from now on
     if (file->file.content) {
         kfree(file->file.content);
+        file->file.content = NULL;
     }
+    file->file.disk_block = 0;
     
     // allocate new content (no null terminator needed for binary)
-    file->file.content = (char*)kmalloc(size);
+    file->file.content = (char*)kmalloc_tagged(size, HEAP_TAG_FILESYSTEM);
     if (!file->file.content) {
         file->file.content_size = 0;
         file->file.content_capacity = 0;
@@ -109,6 +117,99 @@ int set_file_content_binary(File* file, const char* data, size_t size) {
     return 0; // success
 }
 
+/**
+ * get the content of a file, reading it back from disk if it was evicted
+ * @param file the file to read
+ * @returns the content, or NULL if the file is empty or the content cannot be read
+ * @note the content is pinned until file_put_content, the shrinker leaves it alone
+ * while the caller keeps allocating. set_file_content still replaces it.
+ */
+char* file_get_content(File* file) {
+    if (!file || file->type != FILE_NODE) {
+        return NULL;
+    }
+    if (file->file.content || !file->file.disk_block) {
+        if (file->file.content) {
+            file->file.pins++;
+        }
+        return file->file.content;
+    }
+
+    uint8_t content_buffer[SECTOR_SIZE];
+    if (disk_read_sector(boot_drive, file->file.disk_block, content_buffer) != 0) {
+        debugf("[FILE] Failed to read evicted content from disk\n");
+        return NULL;
+    }
+
+    char* content = (char*)kmalloc_tagged(file->file.content_size + 1, HEAP_TAG_FILESYSTEM);
+    if (!content) {
+        debugf("[FILE] Out of memory reloading file content\n");
+        return NULL;
+    }
+    for (size_t i = 0; i < file->file.content_size; i++) {
+        content[i] = content_buffer[i];
+    }
+    content[file->file.content_size] = '\0';
+
+    file->file.content = content;
+    file->file.content_capacity = file->file.content_size + 1;
+    file->file.pins++;
+    contents_reloaded++;
+    return content;
+}
+
+/**
+ * unpin content from file_get_content
+ * @param file the file passed to file_get_content, which returned content
+ */
+void file_put_content(File* file) {
+    if (!file || file->type != FILE_NODE || !file->file.pins) {
+        debugf("[FILE] Content put without a matching get\n");
+        return;
+    }
+    file->file.pins--;
+}
+
+/**
+ * drop the content of clean files below a directory
+ * @returns bytes freed
+ */
+static size_t evict_clean_content(File* dir, size_t wanted) {
+    size_t freed = 0;
+    for (int i = 0; i < dir->folder.childCount && freed < wanted; i++) {
+        File* child = dir->folder.children ? dir->folder.children[i] : NULL;
+        if (!child) continue;
+
+        if (child->type == FOLDER_NODE) {
+            freed += evict_clean_content(child, wanted - freed);
+        } else if (child->file.content && child->file.disk_block && !child->file.pins) {
+            freed += child->file.content_capacity;
+            kfree(child->file.content);
+            child->file.content = NULL;
+            child->file.content_capacity = 0; // content_size is kept for the reload
+            contents_evicted++;
+        }
+    }
+    return freed;
+}
+
+/**
+ * heap shrinker, evicts file content that can be read back from disk
+ * @param wanted bytes the heap is short of
+ * @returns bytes freed
+ */
+size_t file_content_shrink(size_t wanted) {
+    if (!root) {
+        return 0;
+    }
+    return evict_clean_content(root, wanted);
+}
+
+void file_get_content_stats(uint32_t *evicted, uint32_t *reloaded) {
+    *evicted = contents_evicted;
+    *reloaded = contents_reloaded;
+}
+
 /**
  * add child to directory
  * @returns 0 on success, -1 on failure.
@@ -121,11 +222,7 @@ int add_child_to_dir(File* dir, File* child) {
 
     // initialize children array if first child
     if (!dir->folder.children) {
-        /**
-         * @todo we could make this bigger
-         */
-        dir->folder.capacity = 4; 
-        dir->folder.children = (File**)kmalloc(dir->folder.capacity * sizeof(File*));
+        dir->folder.children = children_alloc(&dir->folder.capacity);
         if (!dir->folder.children) {
             debugf("[FILE] Out of memory allocating children node array\n");
             return -1;
@@ -136,7 +233,7 @@ int add_child_to_dir(File* dir, File* child) {
     // grow array if needed
     if (dir->folder.childCount >= dir->folder.capacity) {
         int new_capacity = dir->folder.capacity * 2;
-        File** new_children = (File**)krealloc(dir->folder.children, new_capacity * sizeof(File*));
+        File** new_children = children_realloc(dir->folder.children, dir->folder.capacity, new_capacity);
         if (!new_children) {
             debugf("[FILE] Out of memory reallocating children node array\n");
             return -1;
@@ -316,15 +413,21 @@ static int memory_to_inode(File *memory_file, disk_inode *disk_inode, uint32_t i
     
     // handle file nodes
     if (memory_file->type == FILE_NODE) {
-        // handle file content
-        if (memory_file->file.content) {
+        // evicted content is still in its old block, which a save never frees
+        char *content = memory_file->file.content;
+        if (!content && memory_file->file.disk_block) {
             disk_inode->size = memory_file->file.content_size;
-        } else {
-            disk_inode->size = 0;
+            disk_inode->data_blocks[0] = memory_file->file.disk_block;
+            return 0;
         }
+        if (!content && memory_file->file.content_size) {
+            debugf("[FILE] File content is lost, not saving it as empty\n");
+            return -1;
+        }
+        disk_inode->size = content ? memory_file->file.content_size : 0;
 
         // write content to data blocks (if file has content)
-        if (disk_inode->size > 0 && memory_file->file.content) {
+        if (disk_inode->size > 0 && content) {
             uint32_t data_block = allocate_data_block();
             if (data_block > 0) {
                 disk_inode->data_blocks[0] = data_block;
@@ -342,7 +445,7 @@ static int memory_to_inode(File *memory_file, disk_inode *disk_inode, uint32_t i
                 }
                 
                 for (uint32_t i = 0; i < content_len; i++) {
-                    content_buffer[i] = memory_file->file.content[i];
+                    content_buffer[i] = content[i];
                 }
                 
                 // write content to disk
@@ -353,6 +456,9 @@ static int memory_to_inode(File *memory_file, disk_inode *disk_inode, uint32_t i
                     free_data_block(data_block);
                     disk_inode->data_blocks[0] = 0;
                     debugf("done\n");
+                } else if (content_len == memory_file->file.content_size) {
+                    // the whole content is on disk, it can be evicted now
+                    memory_file->file.disk_block = data_block;
                 }
             }
         }
@@ -365,6 +471,28 @@ static int memory_to_inode(File *memory_file, disk_inode *disk_inode, uint32_t i
     return 0;
 }
 
+/**
+ * check that every file under a directory can be written out
+ * @return false if a file lost its content, saving would store it as empty
+ * @note save_to_disk frees the old inodes first, so it has to refuse before that
+ */
+bool file_tree_saveable(File *dir) {
+    for (int i = 0; i < dir->folder.childCount && i < MAX_CHILDREN_PER_DIR; i++) {
+        if (!dir->folder.children || !dir->folder.children[i]) continue;
+
+        File *child = dir->folder.children[i];
+        if (child->type == FILE_NODE) {
+            if (!child->file.content && !child->file.disk_block && child->file.content_size) {
+                debugf("[FILE] File content is lost, not saving it as empty\n");
+                return false;
+            }
+        } else if (!file_tree_saveable(child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * recursively save directory tree to disk
  */
@@ -396,10 +524,12 @@ int save_directory_recursive(File *dir, uint32_t dir_inode_num, uint32_t parent_
         
         if (child->type == FILE_NODE) {
             disk_inode child_disk_inode;
-            if (memory_to_inode(child, &child_disk_inode, child_inode, dir_inode_num) == 0) {
-                write_inode_to_disk(child_inode, &child_disk_inode);
-                dir_disk_inode.child_inodes[dir_disk_inode.child_count++] = child_inode;
+            if (memory_to_inode(child, &child_disk_inode, child_inode, dir_inode_num) != 0) {
+                free_inode(child_inode); // file_tree_saveable rules this out
+                continue;
             }
+            write_inode_to_disk(child_inode, &child_disk_inode);
+            dir_disk_inode.child_inodes[dir_disk_inode.child_count++] = child_inode;
         } else {
             // recursively save subdirectory
             if (save_directory_recursive(child, child_inode, dir_inode_num) == 0) {
@@ -440,7 +570,8 @@ static File* convert_disk_to_memory_file(disk_inode *disk_inode) {
             
             if (disk_read_sector(boot_drive, disk_inode->data_blocks[0], content_buffer) == 0) {
                 // allocate content
-                memory_file->file.content = (char*)kmalloc(disk_inode->size + 1);
+                memory_file->file.content = (char*)kmalloc_tagged(disk_inode->size + 1,
+                                                                  HEAP_TAG_FILESYSTEM);
                 if (memory_file->file.content) {
                     // copy content to memory file
                     uint32_t content_len = disk_inode->size;
@@ -454,6 +585,9 @@ static File* convert_disk_to_memory_file(disk_inode *disk_inode) {
                     memory_file->file.content[content_len] = '\0';
                     memory_file->file.content_size = content_len;
                     memory_file->file.content_capacity = disk_inode->size + 1;
+                    if (content_len == disk_inode->size) {
+                        memory_file->file.disk_block = disk_inode->data_blocks[0];
+                    }
                 } else {
                     // failed to allocate content memory
                     debugf("[FILE] Out of memory allocating file content\n");
@@ -7,29 +7,56 @@
 #include "file/file_alloc.h"
 #include "print/debug.h"
 
+// File nodes and directory child arrays come from their own object caches
+static kmem_cache *file_cache = NULL;
+static kmem_cache *children_cache = NULL;
+
+/**
+ * put a File into its constructed (empty) state
+ * @note slab pages are zeroed before this runs, file_free runs it again on release
+ */
+static void file_construct(void *object) {
+    File* file = (File*)object;
+    file->name[0] = '\0';
+    file->type = FILE_NODE; // will be set properly later
+    file->parent = NULL;
+
+    // the folder fields share this space, so they are cleared too
+    file->file.content = NULL;
+    file->file.content_size = 0;
+    file->file.content_capacity = 0;
+    file->file.disk_block = 0;
+    file->file.pins = 0;
+}
+
+/**
+ * create the caches on first use
+ * @return true if both caches exist
+ */
+static bool file_caches_init(void) {
+    if (!file_cache) {
+        file_cache = kmem_cache_create("File", sizeof(File), file_construct, NULL,
+                                       HEAP_TAG_FILESYSTEM);
+    }
+    if (!children_cache) {
+        children_cache = kmem_cache_create("Children", MAX_CHILDREN_PER_DIR * sizeof(File*),
+                                           NULL, NULL, HEAP_TAG_FILESYSTEM);
+    }
+    return file_cache && children_cache;
+}
+
 /**
  * file allocator
  * @return pointer to File, or NULL if out of memory
  */
 File* file_alloc() {
-    File* new_file = (File*)kmalloc(sizeof(File));
+    if (!file_caches_init()) {
+        debugf("[FILE ALLOCATOR] Could not create file caches\n");
+        return NULL;
+    }
+
+    File* new_file = (File*)kmem_cache_alloc(file_cache);
     if (new_file) {
-        // clear the allocated memory
-        uint8_t* file_ptr = (uint8_t*)new_file;
-        for (int i = 0; i < sizeof(File); i++) {
-            file_ptr[i] = 0;
-        }
-        
-        // initialize dynamic fields to NULL
-        new_file->name[0] = '\0';
-        new_file->type = FILE_NODE; // will be set properly later
-        new_file->parent = NULL;
-
-        // initialize union fields to NULL
-        new_file->file.content = NULL;
-        new_file->file.content_size = 0;
-        new_file->file.content_capacity = 0;
-        
         file_count++;
     }
     return new_file;
@@ -57,16 +84,77 @@ void file_free(File* file) {
         }
         // free the children array
         if (file->folder.children) {
-            kfree(file->folder.children);
+            children_free(file->folder.children, file->folder.capacity);
             file->folder.children = NULL;
         }
     }
 
-    // free the file and decrease file_count because we just deleted the file.
-    kfree(file);
+    // return the file to its cache and decrease file_count because we just deleted the file.
+    file_construct(file);
+    kmem_cache_free(file_cache, file);
     file_count--;
 }
 
+/**
+ * allocate an array for directory children
+ * @param capacity set to the number of entries in the array
+ * @return the array, or NULL if out of memory
+ */
+File** children_alloc(int *capacity) {
+    if (!file_caches_init()) {
+        return NULL;
+    }
+
+    File** children = (File**)kmem_cache_alloc(children_cache);
+    if (children) {
+        *capacity = MAX_CHILDREN_PER_DIR;
+    }
+    return children;
+}
+
+/**
+ * grow a children array, moving it out of the cache once it is too big
+ * @return the new array, or NULL if out of memory (the old array is kept)
+ */
+File** children_realloc(File** children, int capacity, int new_capacity) {
+    if (capacity != MAX_CHILDREN_PER_DIR) {
+        return (File**)krealloc(children, new_capacity * sizeof(File*));
+    }
+
+    File** new_children = (File**)kmalloc_tagged(new_capacity * sizeof(File*), HEAP_TAG_FILESYSTEM);
+    if (!new_children) {
+        return NULL;
+    }
+    memcpy(new_children, children, capacity * sizeof(File*));
+    kmem_cache_free(children_cache, children);
+    return new_children;
+}
+
+/**
+ * free a children array
+ * @param capacity capacity the array was allocated with
+ */
+void children_free(File** children, int capacity) {
+    if (capacity == MAX_CHILDREN_PER_DIR) {
+        kmem_cache_free(children_cache, children);
+    } else {
+        kfree(children);
+    }
+}
+
+/**
+ * get the statistics of the File and children caches
+ * @return 0 on success, -1 if the caches do not exist yet
+ */
+int file_cache_get_stats(kmem_cache_stats *files, kmem_cache_stats *children) {
+    if (!file_cache || !children_cache) {
+        return -1;
+    }
+    kmem_cache_get_stats(file_cache, files);
+    kmem_cache_get_stats(children_cache, children);
+    return 0;
+}
+
 /**
  * allocate a new inode number
  */
@@ -4,6 +4,9 @@
     Licensed under the MIT license. See license file for details
 */
 #include "filesystem/filesystem.h"
+#include "file/file_alloc.h"
+#include "trace/trace.h"
+#include "stdio/stdio.h"
 #include "print/debug.h"
 
 /**
@@ -21,6 +24,15 @@ static void auto_save_filesystem(void) {
 
 // initialise filesystem.
 void filesystem_init() {
+    // clean file content can be dropped when the heap runs short
+    static bool shrinker_registered = false;
+    if (!shrinker_registered) {
+        shrinker_registered = heap_register_shrinker("file content", file_content_shrink);
+        if (!shrinker_registered) {
+            debugf("[FS] Could not register the content shrinker\n");
+        }
+    }
+
     root = file_alloc();
     if (!root) {
         // root does not exist (file_alloc failed)
@@ -447,15 +459,18 @@ int filesystem_sync(void) {
     return 0; // success
 }
 
-/**
- * save current filesystem to disk
- */
-int filesystem_save_to_disk(void) {
+static int save_to_disk(void) {
     if (!filesystem_mounted || !superblock || !root) {
         debugf("[FS] Filesystem not mounted, superblock or root missing\n");
         return -1;
     }
     
+    // refuse before anything on disk is touched, the old tree stays loadable
+    if (!file_tree_saveable(root)) {
+        debugf("[FS] Filesystem tree cannot be saved\n");
+        return -1;
+    }
+
     // clear all inodes except root
     for (uint32_t i = 2; i < MAX_DISK_INODES; i++) {
         free_inode(i);
@@ -471,6 +486,16 @@ int filesystem_save_to_disk(void) {
     return filesystem_sync();
 }
 
+/**
+ * save current filesystem to disk
+ */
+int filesystem_save_to_disk(void) {
+    TRACE_BEGIN(TRACE_FS_SAVE, 0, 0);
+    int result = save_to_disk();
+    TRACE_END(TRACE_FS_SAVE, (uint32_t)result, 0);
+    return result;
+}
+
 
 /**
  * load filesystem from disk to memory
@@ -683,6 +708,31 @@ int filesystem_get_memory_stats(char *stats_buffer, int buffer_size) {
     int_to_str(sizeof(File), temp, sizeof(temp));
     strcat(stats_buffer, temp);
     strcat(stats_buffer, " bytes\n");
+
+    // the lines below vary in length, they are cut off at the end of the buffer
+    int used = strlen(stats_buffer);
+
+    // everything the filesystem holds on the heap
+    heap_tag_stats heap;
+    heap_get_tag_stats(HEAP_TAG_FILESYSTEM, &heap);
+    used += msnprintf(stats_buffer + used, buffer_size - used, "Heap In Use: %u bytes (peak %u)\n",
+                      (uint32_t)heap.live_bytes, (uint32_t)heap.peak_bytes);
+
+    // content dropped under memory pressure
+    uint32_t evicted, reloaded;
+    file_get_content_stats(&evicted, &reloaded);
+    used += msnprintf(stats_buffer + used, buffer_size - used, "Content Evicted: %u, Reloaded: %u\n",
+                      evicted, reloaded);
+
+    // object caches
+    kmem_cache_stats cache_stats[2];
+    if (file_cache_get_stats(&cache_stats[0], &cache_stats[1]) == 0) {
+        for (int i = 0; i < 2; i++) {
+            used += msnprintf(stats_buffer + used, buffer_size - used, "%s cache: %u/%u objects, %u pages\n",
+                              cache_stats[i].name, cache_stats[i].objects_in_use,
+                              cache_stats[i].objects_total, cache_stats[i].pages);
+        }
+    }
     
     return 0; // success, but the way the code is written makes me want to think it'll fail
 }
@@ -697,9 +747,25 @@ char* get_file_content(const char* filename) {
         
         File* child = cwd->folder.children[i];
         if (child->type == FILE_NODE && strcmp(child->name, filename)) {
-            return child->file.content;
+            return file_get_content(child);
         }
     }
     debugf("[FS] File not found/is folder\n");
     return NULL;
 }
+
+/**
+ * unpin content from get_file_content once the caller is done with it
+ */
+void put_file_content(const char* filename) {
+    if (!cwd->folder.children) {
+        return;
+    }
+    for (int i = 0; i < cwd->folder.childCount; i++) {
+        File* child = cwd->folder.children[i];
+        if (child && child->type == FILE_NODE && strcmp(child->name, filename)) {
+            file_put_content(child);
+            return;
+        }
+    }
+}
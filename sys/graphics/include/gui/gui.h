@@ -89,6 +89,7 @@ int count_lines(const char* text);
 const char* get_line_start(const char* text, int line_num);
 int len_line(const char* line_start);
 char* get_file_content(const char* filename);
+void put_file_content(const char* filename);
 void cursorpos2linecol(int pos, int* line, int* col);
 void draw_file(int x, int y, const char* name, int is_dir, int is_selected);
 int linecol2cursorpos(int line, int col);
@@ -34,6 +34,7 @@ static void initialise_all_entries(void)
     unsigned long keyboard_address;
     unsigned long mouse_address;
     unsigned long timer_address;
+    unsigned long serial_address;
 
     /* IDT entry of timer interrupt (IRQ0) */
     timer_address = (unsigned long)timer_handler;
@@ -43,6 +44,10 @@ static void initialise_all_entries(void)
     keyboard_address = (unsigned long)keyboard_handler;
     idt_set_entry(0x21, keyboard_address, KERNEL_CODE_SEGMENT_OFFSET, INTERRUPT_GATE);
 
+    /* IDT entry of serial interrupt (IRQ4) */
+    serial_address = (unsigned long)serial_handler;
+    idt_set_entry(0x24, serial_address, KERNEL_CODE_SEGMENT_OFFSET, INTERRUPT_GATE);
+
     /* IDT entry of mouse interrupt (IRQ12) */
     mouse_address = (unsigned long)mouse_handler;
     idt_set_entry(0x2C, mouse_address, KERNEL_CODE_SEGMENT_OFFSET, INTERRUPT_GATE);
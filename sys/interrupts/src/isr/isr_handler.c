@@ -6,8 +6,10 @@
 
 #include "print/debug.h"
 #include "libc/lib.h"
+#include "stdio/stdio.h"
 #include "isr/isr.h"
 #include "panic/panic.h"
+#include "paging/paging.h"
 #include <stdint.h>
 
 void isr_handler(void* stack_ptr) {
@@ -16,6 +18,14 @@ void isr_handler(void* stack_ptr) {
     uint32_t vector = stack[12];      // vector number  
     uint32_t error_code = stack[13];  // error code
     char buffer[32];
+    uint32_t fault_addr = 0;
+
+    if (vector == 14) {
+        asm volatile("mov %%cr2, %0" : "=r"(fault_addr));
+        if (page_fault_handler(error_code, fault_addr)) {
+            return; // the page is backed now, retry the access
+        }
+    }
 
     // tell the user that they messed up
     // when really the only thing thats messed up is the code
@@ -36,6 +46,11 @@ void isr_handler(void* stack_ptr) {
         int_to_str(error_code, buffer, sizeof(buffer));
         debugf(buffer);
     }
+    if (vector == 14) {
+        debugf(" | Address: ");
+        msnprintf(buffer, sizeof(buffer), "%x", fault_addr);
+        debugf(buffer);
+    }
     debugf("\n");
 
     panic(exception_messages[vector]);
@@ -5,6 +5,7 @@
 */
 
 #include "keyboard/keyboard.h"
+#include "idle/idle.h"
 
 // initialise keyboard
 void keyboard_init(void)
@@ -28,6 +29,7 @@ void keyboard_handler_main(void)
         keycode = read_port(KEYBOARD_DATA_PORT);
         last_keycode = keycode;
         key_pressed = true;
+        idle_wake();
     }
 
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 */
 
 #include "mouse/mouse.h"
+#include "idle/idle.h"
 
 // mouse state
 static mouse_state mouse_states = {0, 0, 0, 0, 0, 320, 240}; // Start at center of 640x480 screen
@@ -121,6 +122,7 @@ void mouse_handler_main(void) {
             if (mouse_states.y_position < 0) mouse_states.y_position = 0;
             if (mouse_states.y_position >= 480) mouse_states.y_position = 479;
 
+            idle_wake();
             break;
             
         default:
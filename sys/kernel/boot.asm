@@ -7,8 +7,8 @@ bits 32
 section .text
         align 4
         dd 0x1BADB002         
-        dd 0x00               
-        dd - (0x1BADB002 + 0x00) 
+        dd 0x02               ; ask for the memory map
+        dd - (0x1BADB002 + 0x02) 
 
 ; global
 global start
@@ -19,6 +19,8 @@ extern kernel_main
 start:
   cli 			      
   mov esp, stack_space	
+  push ebx              ; multiboot information
+  push eax              ; multiboot magic
   call kernel_main      ; kernel_main from kernel/kernel.c
   hlt		 	   
 
@@ -0,0 +1,43 @@
+/*
+    MooseOS ACPI tables
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+// where the BIOS leaves the root pointer
+#define ACPI_EBDA_POINTER   0x040E  // real mode segment of the extended BIOS data area
+#define ACPI_BIOS_START     0x000E0000
+#define ACPI_BIOS_END       0x00100000
+
+// every table starts with this
+typedef struct {
+    char signature[4];
+    uint32_t length;        // including this header
+    uint8_t revision;
+    uint8_t checksum;       // all bytes of the table sum to 0
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_header;
+
+// where a table says a device's registers are
+typedef struct {
+    uint8_t address_space;  // 0 for memory, 1 for I/O ports
+    uint8_t bit_width;
+    uint8_t bit_offset;
+    uint8_t access_size;
+    uint64_t address;
+} __attribute__((packed)) acpi_address;
+
+#define ACPI_SPACE_MEMORY 0
+
+const acpi_header *acpi_find_table(const char *signature);
+
+#endif // ACPI_H
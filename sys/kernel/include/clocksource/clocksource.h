@@ -0,0 +1,33 @@
+/*
+    MooseOS Clocksource
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef CLOCKSOURCE_H
+#define CLOCKSOURCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CLOCKSOURCE_CALIBRATE_MS   10 // one PIT countdown
+#define CLOCKSOURCE_CALIBRATE_RUNS 3  // the shortest run wins, interruptions only add time
+
+// a free running counter and how to turn its counts into nanoseconds
+typedef struct {
+    const char *name;
+    uint64_t (*read)(void);
+    uint32_t mult;  // ns = counts * mult >> shift
+    uint32_t shift;
+} clocksource;
+
+bool clocksource_init(void);
+bool clocksource_ready(void);
+const char *clocksource_name(void);
+uint32_t clocksource_tsc_khz(void);
+
+uint64_t ktime_ns(void);
+void udelay(uint32_t us);
+void mdelay(uint32_t ms);
+
+#endif // CLOCKSOURCE_H
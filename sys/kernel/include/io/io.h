@@ -20,4 +20,21 @@ void outb(uint16_t port, uint8_t data);
 uint16_t inw(uint16_t port);
 void outw(uint16_t port, uint16_t data);
 
+/**
+ * disable interrupts
+ * @return the previous flags, for irq_restore
+ */
+static inline unsigned long irq_save(void) {
+    unsigned long flags;
+    asm volatile("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/**
+ * put the interrupt flag back the way irq_save found it
+ */
+static inline void irq_restore(unsigned long flags) {
+    asm volatile("push %0\n\tpopf" : : "r"(flags) : "memory", "cc");
+}
+
 #endif // IO_H_
@@ -0,0 +1,49 @@
+/*
+    MooseOS Multiboot
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include <stdint.h>
+
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002  // in EAX when a multiboot loader jumps to us
+
+// multiboot_info flags
+#define MULTIBOOT_INFO_MEMORY       0x001       // mem_lower and mem_upper are valid
+#define MULTIBOOT_INFO_MEM_MAP      0x040       // mmap_length and mmap_addr are valid
+
+// memory map entry types
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+#define MULTIBOOT_MEMORY_RESERVED   2
+#define MULTIBOOT_MEMORY_ACPI       3
+#define MULTIBOOT_MEMORY_NVS        4
+#define MULTIBOOT_MEMORY_BADRAM     5
+
+// the start of the information structure, the rest is not used
+typedef struct {
+    uint32_t flags;
+    uint32_t mem_lower;     // KB of memory below 1MB
+    uint32_t mem_upper;     // KB of memory from 1MB to the first hole
+    uint32_t boot_device;
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;   // size of the memory map in bytes
+    uint32_t mmap_addr;     // physical address of the first entry
+} __attribute__((packed)) multiboot_info;
+
+// size does not include itself, entries are size + 4 bytes apart
+typedef struct {
+    uint32_t size;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry;
+
+void multiboot_read_memory_map(uint32_t magic, const multiboot_info *info);
+
+#endif // MULTIBOOT_H
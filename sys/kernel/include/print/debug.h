@@ -10,5 +10,15 @@
 #include <stddef.h>
 #include "qemu/qemu.h"
 
+// size of the kernel log ring, older messages are overwritten
+#define DEBUG_LOG_SIZE 16384
+
+// QEMU's debug console, reads back 0xE9 when it is attached
+#define DEBUGCON_PORT 0xE9
+
 void debugf(const char* str);
-#endif // DEBUG_H
\ No newline at end of file
+void debug_flush(void);
+void debug_flush_sync(void);
+size_t debug_log_copy(char* buffer, size_t size);
+uint32_t debug_log_dropped(void);
+#endif // DEBUG_H
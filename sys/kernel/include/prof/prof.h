@@ -0,0 +1,53 @@
+/*
+    MooseOS Sampling profiler
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pit/pit.h"
+
+#define PROF_SAMPLES    8192 // samples kept per run, later ones are counted as dropped
+#define PROF_DEFAULT_HZ 997  // prime, so sampling does not march in step with periodic work
+#define PROF_MIN_HZ     19   // the PIT divisor is 16 bits
+#define PROF_MAX_HZ     10000
+
+/**
+ * build with `make PROF_FRAMES=1` to keep frame pointers and record
+ * call stacks, otherwise only the interrupted instruction is recorded
+ */
+#ifdef PROF_FRAMES
+#define PROF_DEPTH 8
+#else
+#define PROF_DEPTH 1
+#endif
+
+typedef struct {
+    bool running;
+    uint32_t hz;
+    uint32_t samples;  // samples recorded in the current or last run
+    uint32_t dropped;  // samples that did not fit
+} prof_stats;
+
+extern volatile bool prof_running;
+
+void prof_start(uint32_t hz);
+void prof_stop(void);
+uint32_t prof_dump(void);
+void prof_get_stats(prof_stats *stats);
+void prof_record(const timer_frame *frame);
+
+/**
+ * take a sample from the timer interrupt, costs a load and a branch when not profiling
+ */
+static inline void prof_sample(const timer_frame *frame) {
+    if (prof_running) {
+        prof_record(frame);
+    }
+}
+
+#endif // PROF_H
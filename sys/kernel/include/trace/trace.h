@@ -0,0 +1,67 @@
+/*
+    MooseOS Event tracer
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_RECORDS 8192 // ring size in records, power of two
+
+// record phases, the same letters Chrome's trace format uses
+#define TRACE_PHASE_BEGIN   'B'
+#define TRACE_PHASE_END     'E'
+#define TRACE_PHASE_INSTANT 'i'
+
+typedef enum {
+    TRACE_TIMER_IRQ = 1,  // timer interrupt handler
+    TRACE_TASK_SWITCH,    // arg0 = previous task, arg1 = next task
+    TRACE_DISK_READ,      // arg0 = lba, arg1 = result on end
+    TRACE_DISK_WRITE,     // arg0 = lba, arg1 = result on end
+    TRACE_FS_SAVE,        // arg0 = result on end
+    TRACE_IDLE,           // arg0 = longest sleep in ms, arg1 = halts so far on end
+    TRACE_EVENT_COUNT
+} trace_event_id;
+
+// one event, 20 bytes
+typedef struct {
+    uint64_t tsc;
+    uint16_t event;
+    uint8_t phase;
+    uint8_t reserved;
+    uint32_t arg0;
+    uint32_t arg1;
+} __attribute__((packed)) trace_record;
+
+typedef struct {
+    bool enabled;
+    uint32_t recorded;    // records written since boot
+    uint32_t overwritten; // records lost to the ring wrapping
+} trace_stats;
+
+extern volatile bool trace_enabled;
+
+void trace_write(uint16_t event, uint8_t phase, uint32_t arg0, uint32_t arg1);
+void trace_set_enabled(bool enabled);
+void trace_set_tsc_khz(uint32_t khz);
+uint32_t trace_dump(void);
+void trace_get_stats(trace_stats *stats);
+
+/**
+ * record an event if tracing is on, costs a load and a branch when it is off
+ */
+static inline void trace_event(uint16_t event, uint8_t phase, uint32_t arg0, uint32_t arg1) {
+    if (trace_enabled) {
+        trace_write(event, phase, arg0, arg1);
+    }
+}
+
+#define TRACE_BEGIN(event, arg0, arg1)   trace_event(event, TRACE_PHASE_BEGIN, arg0, arg1)
+#define TRACE_END(event, arg0, arg1)     trace_event(event, TRACE_PHASE_END, arg0, arg1)
+#define TRACE_INSTANT(event, arg0, arg1) trace_event(event, TRACE_PHASE_INSTANT, arg0, arg1)
+
+#endif // TRACE_H
@@ -6,7 +6,13 @@
 
 #include "idt/idt.h"
 #include "paging/paging.h"
+#include "memmap/memmap.h"
+#include "multiboot/multiboot.h"
+#include "heap/heap.h"
+#include "zeropool/zeropool.h"
 #include "task/task.h"
+#include "idle/idle.h"
+#include "timer/timer.h"
 #include "mouse/mouse.h"
 #include "keyboard/keyboard.h"
 #include "ata/ata.h"
@@ -16,6 +22,8 @@
 #include "dock.h"
 #include "rtc/rtc.h"
 #include "pit/pit.h"
+#include "clocksource/clocksource.h"
+#include "serial/serial.h"
 #include "vga/vga.h"
 #include "speaker/speaker.h"
 #include "print/debug.h"
@@ -94,24 +102,24 @@ void kernel_handle_interrupts() {
     } else if (explorer_active) {
         explorer_handle_mouse();
     }
-    dock_update_time();
 }
 
-// update time task
-void kernel_update_time() {
-    dock_update_time();
-}
-
-
 // main kernel loop
 void main_loop() {
     while (1) {
         run_tasks();
+        // callbacks of due timers, the dock clock among them
+        timer_run();
+        // spare time goes into zeroing frames ahead of time
+        bool pool_busy = !zero_pool_refill(ZERO_POOL_BATCH);
+        debug_flush();
         task_yield();
+        // halt until input arrives or the next timer is due
+        idle_pass(pool_busy, timer_ms_until_next(IDLE_MAX_SLEEP_MS));
     }
 }
 
-void kernel_main(void) 
+void kernel_main(uint32_t multiboot_magic, const multiboot_info *multiboot) 
 {
     /**
      * @note debugf only prints in QEMU environment.
@@ -121,25 +129,42 @@ void kernel_main(void)
      * we would now initialise every. single. thing.
      * @note: initialisation order is important.
      */
+    // memory functions pick their variants before anything large is copied
+    if (string_init()) {
+        debugf("[MOOSE]: SSE2 memory functions enabled\n");
+    }
     vga_init_custom_palette();
 
     gui_init();
     debugf("[MOOSE]: GUI initialised\n");
 
-    // initialize paging with 16MB of memory
-    paging_init(16 * 1024 * 1024);
+    // size memory from the bootloader's map, before the frame allocator reuses it
+    multiboot_read_memory_map(multiboot_magic, multiboot);
+    paging_init(memmap_end());
     debugf("[MOOSE]: Paging initialised\n");
+
+    // leave a quarter of RAM for page tables, stacks and programs
+    heap_set_limit(memmap_usable_bytes() / 4 * 3);
     idt_init();
     debugf("[MOOSE]: IDT initialised\n");
     isr_init();
     debugf("[MOOSE]: ISR handlers installed\n");
 
+    // after paging, the HPET is found through ACPI and mapped
+    if (clocksource_init()) {
+        debugf("[MOOSE]: Clocksource initialised\n");
+    }
+
     mouse_init(); 
     debugf("[MOOSE]: Mouse initialised\n");
 
     keyboard_init(); 
     debugf("[MOOSE]: Keyboard initialised\n");
 
+    // after keyboard_init, which sets the PIC masks this unmasks IRQ4 in
+    serial_init(SERIAL_DEFAULT_BAUD);
+    debugf("[MOOSE]: Serial initialised\n");
+
     dock_init();
     debugf("[MOOSE]: Dock initialised\n");
     
@@ -0,0 +1,129 @@
+/*
+    MooseOS ACPI tables
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Only finding tables is supported, there is no AML interpreter.
+    Tables usually sit at the top of RAM or above it, so each one is
+    mapped before it is read.
+*/
+
+#include "acpi/acpi.h"
+#include "paging/paging.h"
+#include "string/string.h"
+#include "print/debug.h"
+
+// root system description pointer
+typedef struct {
+    char signature[8];      // "RSD PTR "
+    uint8_t checksum;       // over the first 20 bytes
+    char oem_id[6];
+    uint8_t revision;       // 0 for ACPI 1.0, 2 and up have the fields below
+    uint32_t rsdt_address;
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t extended_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed)) acpi_rsdp;
+
+static const acpi_header *root = NULL;
+static uint32_t root_entry_size = 0; // 4 for the RSDT, 8 for the XSDT
+static bool root_searched = false;
+
+static bool checksum_ok(const void *data, uint32_t length) {
+    const uint8_t *bytes = data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+static const acpi_rsdp *scan_rsdp(uint32_t start, uint32_t end) {
+    // the pointer is on a 16 byte boundary
+    for (uint32_t addr = start; addr + sizeof(acpi_rsdp) <= end; addr += 16) {
+        const acpi_rsdp *rsdp = (const acpi_rsdp *)addr;
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && checksum_ok(rsdp, 20)) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * map a table and check it
+ * @return the table, NULL if it cannot be reached or is damaged
+ */
+static const acpi_header *map_table(uint64_t address) {
+    if (!address || address >> 32) {
+        return NULL;
+    }
+    uint32_t phys = (uint32_t)address;
+    if (!paging_map_identity(phys, sizeof(acpi_header), 0)) {
+        return NULL;
+    }
+    const acpi_header *table = (const acpi_header *)phys;
+    if (table->length < sizeof(acpi_header) || !paging_map_identity(phys, table->length, 0)) {
+        return NULL;
+    }
+    return checksum_ok(table, table->length) ? table : NULL;
+}
+
+static void find_root(void) {
+    root_searched = true;
+
+    // the first KB of the EBDA, then the BIOS area
+    const acpi_rsdp *rsdp = NULL;
+    uint16_t segment;
+    memcpy(&segment, (const void *)ACPI_EBDA_POINTER, sizeof(segment));
+    uint32_t ebda = (uint32_t)segment << 4;
+    if (ebda) {
+        rsdp = scan_rsdp(ebda, ebda + 1024);
+    }
+    if (!rsdp) {
+        rsdp = scan_rsdp(ACPI_BIOS_START, ACPI_BIOS_END);
+    }
+    if (!rsdp) {
+        debugf("[ACPI] No RSDP found\n");
+        return;
+    }
+
+    if (rsdp->revision >= 2 && checksum_ok(rsdp, rsdp->length)) {
+        root = map_table(rsdp->xsdt_address);
+        root_entry_size = 8;
+    }
+    if (!root) {
+        root = map_table(rsdp->rsdt_address);
+        root_entry_size = 4;
+    }
+    if (!root) {
+        debugf("[ACPI] Root table is damaged or out of reach\n");
+    }
+}
+
+/**
+ * find a table by its signature
+ * @param signature four characters, e.g. "HPET"
+ * @return the table, NULL if there is none
+ * @note needs paging, the table may be mapped on the way
+ */
+const acpi_header *acpi_find_table(const char *signature) {
+    if (!root_searched) {
+        find_root();
+    }
+    if (!root) {
+        return NULL;
+    }
+
+    const uint8_t *entries = (const uint8_t *)root + sizeof(acpi_header);
+    uint32_t count = (root->length - sizeof(acpi_header)) / root_entry_size;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t address = 0;
+        memcpy(&address, entries + i * root_entry_size, root_entry_size);
+        const acpi_header *table = map_table(address);
+        if (table && memcmp(table->signature, signature, 4) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
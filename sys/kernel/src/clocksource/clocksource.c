@@ -0,0 +1,195 @@
+/*
+    MooseOS Clocksource
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    The TSC is timed against a PIT countdown at boot. If the CPU says
+    the TSC runs at a constant rate it becomes the clock, otherwise the
+    HPET does when there is one, and the TSC again when there is not.
+
+    Counts become nanoseconds with a multiply and a shift. The kernel
+    does not link libgcc, so there is no 64 bit division at run time.
+*/
+
+#include "clocksource/clocksource.h"
+#include "hpet/hpet.h"
+#include "pit/pit.h"
+#include "speaker/speaker.h"
+#include "io/io.h"
+#include "cpuid/cpuid.h"
+#include "tsc/tsc.h"
+#include "trace/trace.h"
+#include "stdio/stdio.h"
+#include "print/debug.h"
+
+#define PIT_CHANNEL_2_OUT        0x20 // in SPEAKER_PORT, high once channel 2 counts down
+#define CPUID_EXT_POWER          0x80000007
+#define CPUID_EDX_INVARIANT_TSC  (1 << 8)
+#define CALIBRATE_MAX_CYCLES     0xFFFFFFFFu // gives up on a PIT that never counts down
+
+static clocksource source; // read is NULL until clocksource_init
+static uint64_t boot_count = 0;
+static uint32_t tsc_khz = 0;
+
+static uint64_t read_tsc(void) {
+    return rdtsc();
+}
+
+/**
+ * @return TSC frequency in kHz, 0 if the PIT could not time it
+ * @note uses PIT channel 2, call before the speaker is in use
+ */
+static uint32_t calibrate_tsc(void) {
+    uint32_t latch = PIT_BASE_FREQUENCY / (1000 / CLOCKSOURCE_CALIBRATE_MS);
+    uint64_t best = CALIBRATE_MAX_CYCLES;
+
+    unsigned long flags = irq_save();
+    uint8_t port = inb(SPEAKER_PORT);
+    for (int run = 0; run < CLOCKSOURCE_CALIBRATE_RUNS; run++) {
+        // gate channel 2 with the speaker off, then count down once
+        outb(SPEAKER_PORT, (port & ~SPEAKER_DATA_BIT) | SPEAKER_GATE_BIT);
+        outb(PIT_COMMAND, PIT_CHANNEL_2_SEL | PIT_ACCESS_LOHI | PIT_MODE_0 | PIT_BINARY);
+        outb(PIT_CHANNEL_2, latch & 0xFF);
+        outb(PIT_CHANNEL_2, (latch >> 8) & 0xFF);
+
+        uint64_t start = rdtsc();
+        uint64_t cycles = 0;
+        while (!(inb(SPEAKER_PORT) & PIT_CHANNEL_2_OUT) && cycles < CALIBRATE_MAX_CYCLES) {
+            cycles = rdtsc() - start;
+        }
+        cycles = rdtsc() - start;
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    outb(SPEAKER_PORT, port);
+    irq_restore(flags);
+
+    if (best >= CALIBRATE_MAX_CYCLES) {
+        return 0;
+    }
+    return div64_32(best, CLOCKSOURCE_CALIBRATE_MS);
+}
+
+static bool tsc_invariant(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax < CPUID_EXT_POWER) {
+        return false;
+    }
+    cpuid(CPUID_EXT_POWER, &eax, &ebx, &ecx, &edx);
+    return edx & CPUID_EDX_INVARIANT_TSC;
+}
+
+/**
+ * pick mult and shift for counts that last num / den nanoseconds,
+ * as large a shift as keeps mult in 32 bits
+ */
+static void set_rate(uint32_t num, uint32_t den) {
+    uint32_t shift = 32;
+    while (shift && (((uint64_t)num << shift) >> 32) >= den) {
+        shift--;
+    }
+    source.mult = div64_32((uint64_t)num << shift, den);
+    source.shift = shift;
+}
+
+static uint64_t counts_to_ns(uint64_t counts) {
+    // two 32x32 products instead of one 64x32, which could overflow
+    uint64_t low = ((uint64_t)(uint32_t)counts * source.mult) >> source.shift;
+    uint64_t high = ((uint64_t)(uint32_t)(counts >> 32) * source.mult) << (32 - source.shift);
+    return low + high;
+}
+
+/**
+ * calibrate the TSC and choose the clock
+ * @return false if there is no usable clock, delays stay rough then
+ * @note needs paging for the HPET, and must run before the speaker is used
+ */
+bool clocksource_init(void) {
+    tsc_khz = calibrate_tsc();
+
+    if (!tsc_invariant() && hpet_init()) {
+        source.name = "hpet";
+        source.read = hpet_read;
+        set_rate(hpet_period_fs(), 1000000);
+    } else if (tsc_khz) {
+        source.name = "tsc";
+        source.read = read_tsc;
+        set_rate(1000000, tsc_khz);
+    } else {
+        debugf("[CLOCK] TSC calibration failed and there is no HPET\n");
+        return false;
+    }
+    boot_count = source.read();
+    trace_set_tsc_khz(tsc_khz);
+
+    char line[64];
+    msnprintf(line, sizeof(line), "[CLOCK] Using %s, TSC at %u kHz\n", source.name, tsc_khz);
+    debugf(line);
+    return true;
+}
+
+/**
+ * @return true once ktime_ns counts
+ */
+bool clocksource_ready(void) {
+    return source.read != NULL;
+}
+
+/**
+ * @return name of the clock in use, "none" before clocksource_init
+ */
+const char *clocksource_name(void) {
+    return source.read ? source.name : "none";
+}
+
+/**
+ * @return TSC frequency in kHz, 0 if it has not been measured
+ */
+uint32_t clocksource_tsc_khz(void) {
+    return tsc_khz;
+}
+
+/**
+ * @return nanoseconds since clocksource_init, 0 before it
+ */
+uint64_t ktime_ns(void) {
+    if (!source.read) {
+        return 0;
+    }
+    return counts_to_ns(source.read() - boot_count);
+}
+
+/**
+ * wait at least us microseconds
+ */
+void udelay(uint32_t us) {
+    if (!source.read) {
+        // no clock yet, a write to the POST port takes about a microsecond
+        for (uint32_t i = 0; i < us; i++) {
+            outb(0x80, 0);
+        }
+        return;
+    }
+    uint64_t end = ktime_ns() + (uint64_t)us * 1000;
+    while (ktime_ns() < end) {
+        asm volatile("pause");
+    }
+}
+
+/**
+ * wait at least ms milliseconds
+ */
+void mdelay(uint32_t ms) {
+    if (!source.read) {
+        while (ms--) {
+            udelay(1000);
+        }
+        return;
+    }
+    uint64_t end = ktime_ns() + (uint64_t)ms * 1000000;
+    while (ktime_ns() < end) {
+        asm volatile("pause");
+    }
+}
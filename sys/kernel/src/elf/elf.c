@@ -70,7 +70,7 @@ bool elf_parse(void* elf_data, elf_load_info* out_info) {
     }
 
     size_t seg_count = 0;
-    elf_segment* segments_arr = kmalloc(sizeof(elf_segment) * header->e_phnum);
+    elf_segment* segments_arr = kmalloc_tagged(sizeof(elf_segment) * header->e_phnum, HEAP_TAG_ELF);
     elf_phdr* phdrs = (elf_phdr*) ((uint8_t*) elf_data + header->e_phoff);
 
     for (size_t i = 0; i < header->e_phnum; i++) {
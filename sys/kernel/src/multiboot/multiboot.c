@@ -0,0 +1,78 @@
+/*
+    MooseOS Multiboot
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#include "multiboot/multiboot.h"
+#include "memmap/memmap.h"
+#include "stdio/stdio.h"
+#include "print/debug.h"
+
+// highest byte a 32 bit kernel can use, page aligned
+#define MULTIBOOT_ADDR_LIMIT 0xFFFFF000ull
+
+static const char *memory_type_name(uint32_t type) {
+    switch (type) {
+        case MULTIBOOT_MEMORY_AVAILABLE: return "usable";
+        case MULTIBOOT_MEMORY_ACPI: return "ACPI";
+        case MULTIBOOT_MEMORY_NVS: return "ACPI NVS";
+        case MULTIBOOT_MEMORY_BADRAM: return "bad";
+        default: return "reserved";
+    }
+}
+
+/**
+ * read the bootloader's memory map into memmap and print it
+ * @param magic EAX at entry, MULTIBOOT_BOOTLOADER_MAGIC if info is valid
+ * @param info EBX at entry
+ * @note call this before paging_init, the frame allocator
+ *       overwrites free memory and the map may be in it
+ */
+void multiboot_read_memory_map(uint32_t magic, const multiboot_info *info) {
+    char line[80];
+
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC || !info) {
+        debugf("[MEMMAP] No multiboot information, assuming 16MB\n");
+        return;
+    }
+
+    if (info->flags & MULTIBOOT_INFO_MEM_MAP) {
+        uint32_t addr = info->mmap_addr;
+        uint32_t end = info->mmap_addr + info->mmap_length;
+        while (addr < end) {
+            const multiboot_mmap_entry *entry = (const multiboot_mmap_entry*)addr;
+            uint64_t start = entry->addr;
+            uint64_t stop = entry->addr + entry->len;
+
+            if (start >= MULTIBOOT_ADDR_LIMIT) {
+                debugf("[MEMMAP] Region above 4GB ignored\n");
+            } else {
+                if (stop > MULTIBOOT_ADDR_LIMIT) {
+                    stop = MULTIBOOT_ADDR_LIMIT;
+                }
+                msnprintf(line, sizeof(line), "[MEMMAP] %08x-%08x %s\n",
+                          (uint32_t)start, (uint32_t)stop - 1, memory_type_name(entry->type));
+                debugf(line);
+                if (entry->type == MULTIBOOT_MEMORY_AVAILABLE) {
+                    memmap_add_usable((uint32_t)start, (uint32_t)stop);
+                }
+            }
+            addr += entry->size + sizeof(entry->size);
+        }
+    } else if (info->flags & MULTIBOOT_INFO_MEMORY) {
+        // no map, only the size of the first stretch above 1MB
+        memmap_add_usable(0, info->mem_lower * 1024);
+        memmap_add_usable(0x100000, 0x100000 + info->mem_upper * 1024);
+        debugf("[MEMMAP] No memory map, using the lower and upper memory sizes\n");
+    } else {
+        debugf("[MEMMAP] Bootloader reported no memory, assuming 16MB\n");
+        return;
+    }
+
+    uint32_t count;
+    memmap_regions(&count);
+    msnprintf(line, sizeof(line), "[MEMMAP] %u MB usable in %u regions\n",
+              memmap_usable_bytes() >> 20, count);
+    debugf(line);
+}
@@ -18,6 +18,7 @@ void panic(const char* message) {
 	draw_text(10, 70, message, VGA_COLOUR_WHITE);
 	draw_text(10, 100, "System halted. Please restart.", VGA_COLOUR_WHITE);
 	debugf("[MOOSE] PANIC!\n");
+	debug_flush_sync();
 	
 	// halt the CPU
 	while (1) {
@@ -1,28 +1,151 @@
 /*
-    MooseOS Mouse interrupt handler code
+    MooseOS debugf code
     Copyright (c) 2025 Ethan Zhang
     Licensed under the MIT license. See license file for details
 */
 
 #include "print/debug.h"
+#include "string/string.h"
+#include "serial/serial.h"
 
-// check if the serial port is ready to transmit
-static int serial_is_transmit_empty(void) {
-    return inb(0x3F8 + 5) & 0x20;
+/*
+ * debugf appends to a ring and returns, the ring is sent to the
+ * debug console or serial port when there is time (debug_flush).
+ * a writer reserves its bytes with one atomic add, so an interrupt
+ * handler can log while the code it interrupted is logging too.
+ * positions count every byte ever written and wrap by masking.
+ */
+static char log_ring[DEBUG_LOG_SIZE];
+static volatile uint32_t log_head = 0;    // bytes reserved so far
+static volatile uint32_t log_writers = 0; // writers still copying into the ring
+static volatile bool log_draining = false;
+static uint32_t log_sent = 0;             // bytes handed to a port
+static uint32_t log_dropped = 0;          // bytes overwritten before they were sent
+static int debugcon_present = -1;         // -1 until first checked
+
+static bool has_debugcon(void) {
+    if (debugcon_present < 0) {
+        debugcon_present = inb(DEBUGCON_PORT) == DEBUGCON_PORT;
+    }
+    return debugcon_present;
+}
+
+/**
+ * send part of the ring to a port
+ * @param wait wait on the serial port instead of stopping when it is busy
+ * @return number of bytes sent
+ */
+static uint32_t log_send(const char* data, uint32_t len, bool wait) {
+    if (has_debugcon()) {
+        // the debug console takes everything at once
+        uint32_t count = len;
+        asm volatile("rep outsb" : "+S"(data), "+c"(count) : "d"(DEBUGCON_PORT) : "memory");
+        return len;
+    }
+    if (wait) {
+        serial_write_sync(data, len);
+        return len;
+    }
+    return serial_write(data, len);
 }
 
-// write a single character to serial
-void serial_write_char(char c) {
-    while (!serial_is_transmit_empty());
-    outb(0x3F8, (uint8_t)c);
+/**
+ * send logged bytes until the port is busy or the ring is empty
+ */
+static void log_drain(bool wait) {
+    uint32_t head = log_head;
+    if (head - log_sent > DEBUG_LOG_SIZE) {
+        log_dropped += head - log_sent - DEBUG_LOG_SIZE;
+        log_sent = head - DEBUG_LOG_SIZE;
+    }
+    while (log_sent != head) {
+        uint32_t offset = log_sent % DEBUG_LOG_SIZE;
+        uint32_t len = head - log_sent;
+        if (len > DEBUG_LOG_SIZE - offset) {
+            len = DEBUG_LOG_SIZE - offset; // up to the end of the ring, then from the start
+        }
+        uint32_t sent = log_send(log_ring + offset, len, wait);
+        log_sent += sent;
+        if (sent < len) {
+            break;
+        }
+    }
 }
 
-// write a null-terminated string to serial
+// add a null-terminated string to the kernel log
+/**
+ * @note only sent out when running in QEMU, the log itself is always kept (see dmesg)
+ */
 void debugf(const char* str) {
-	if (!detect_qemu()) {
-		return; // Only output if running in QEMU
-	}
-    for (size_t i = 0; str[i]; i++) {
-        serial_write_char(str[i]);
+    uint32_t len = strlen(str);
+    if (len > DEBUG_LOG_SIZE) {
+        str += len - DEBUG_LOG_SIZE;
+        len = DEBUG_LOG_SIZE;
+    }
+
+    __atomic_add_fetch(&log_writers, 1, __ATOMIC_ACQUIRE);
+    uint32_t start = __atomic_fetch_add(&log_head, len, __ATOMIC_RELAXED);
+    uint32_t offset = start % DEBUG_LOG_SIZE;
+    uint32_t first = len < DEBUG_LOG_SIZE - offset ? len : DEBUG_LOG_SIZE - offset;
+    memcpy(log_ring + offset, str, first);
+    memcpy(log_ring, str + first, len - first);
+    __atomic_sub_fetch(&log_writers, 1, __ATOMIC_RELEASE);
+
+    debug_flush();
+}
+
+/**
+ * send what the ports take without waiting, called often from the main loop
+ * @note does nothing while a message is half copied or another flush is running
+ */
+void debug_flush(void) {
+    if (!detect_qemu()) {
+        return;
     }
-}
\ No newline at end of file
+    if (__atomic_exchange_n(&log_draining, true, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    if (log_writers == 0) {
+        log_drain(false);
+    }
+    __atomic_store_n(&log_draining, false, __ATOMIC_RELEASE);
+}
+
+/**
+ * send everything that is left, waiting on the serial port,
+ * for when the system is about to stop (panic)
+ */
+void debug_flush_sync(void) {
+    if (!detect_qemu()) {
+        return;
+    }
+    log_drain(true);
+}
+
+/**
+ * copy the most recent part of the log
+ * @param buffer filled with up to size - 1 bytes and terminated
+ * @return number of bytes copied
+ */
+size_t debug_log_copy(char* buffer, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    uint32_t head = log_head;
+    uint32_t len = head < DEBUG_LOG_SIZE ? head : DEBUG_LOG_SIZE;
+    if (len > size - 1) {
+        len = size - 1;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        buffer[i] = log_ring[(head - len + i) % DEBUG_LOG_SIZE];
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+/**
+ * @return bytes overwritten before they could be sent
+ */
+uint32_t debug_log_dropped(void) {
+    return log_dropped;
+}
@@ -0,0 +1,125 @@
+/*
+    MooseOS Sampling profiler
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    While running, every timer interrupt records where the kernel was
+    when it fired. The timer is sped up to the sampling rate for the
+    run and put back afterwards.
+
+    prof_dump sends the samples over serial as text lines. Capture the
+    serial output and turn it into folded stacks for a flame graph with
+    scripts/prof_fold.py, which symbolizes against bin/MooseOS.elf.
+*/
+
+#include "prof/prof.h"
+#include "serial/serial.h"
+#include "stdio/stdio.h"
+#include "string/string.h"
+
+#define PROF_LINE_PREFIX "[PROF] "
+#define PROF_STACK_SPAN  0x10000 // how far above the interrupt frame a caller's frame may be
+
+volatile bool prof_running = false;
+
+static uint32_t prof_pcs[PROF_SAMPLES][PROF_DEPTH]; // innermost first, 0 ends a short stack
+static uint32_t prof_count = 0;
+static uint32_t prof_dropped = 0;
+static uint32_t prof_hz = 0;
+
+/**
+ * start a fresh run
+ * @param hz samples per second, clamped to what the PIT can do
+ */
+void prof_start(uint32_t hz) {
+    if (hz < PROF_MIN_HZ) {
+        hz = PROF_MIN_HZ;
+    } else if (hz > PROF_MAX_HZ) {
+        hz = PROF_MAX_HZ;
+    }
+    prof_running = false;
+    prof_count = 0;
+    prof_dropped = 0;
+    prof_hz = hz;
+    pit_set_frequency(hz);
+    prof_running = true;
+}
+
+void prof_stop(void) {
+    prof_running = false;
+    pit_set_frequency(PIT_TIMER_FREQUENCY);
+}
+
+// called from the timer interrupt
+void prof_record(const timer_frame *frame) {
+    if (prof_count >= PROF_SAMPLES) {
+        prof_dropped++;
+        return;
+    }
+    uint32_t *pcs = prof_pcs[prof_count++];
+    pcs[0] = frame->eip;
+
+#ifdef PROF_FRAMES
+    // follow the saved frame pointers up the interrupted stack
+    uintptr_t low = (uintptr_t)frame;
+    const uint32_t *fp = (const uint32_t *)frame->ebp;
+    int depth = 1;
+    while (depth < PROF_DEPTH) {
+        uintptr_t addr = (uintptr_t)fp;
+        if (addr <= low || addr - (uintptr_t)frame > PROF_STACK_SPAN || (addr & 3) || !fp[1]) {
+            break;
+        }
+        pcs[depth++] = fp[1];
+        low = addr;
+        fp = (const uint32_t *)fp[0];
+    }
+    while (depth < PROF_DEPTH) {
+        pcs[depth++] = 0; // whole rows compare equal when stacks repeat
+    }
+#endif
+}
+
+static void prof_send_line(const char *line) {
+    serial_write_sync(line, strlen(line));
+}
+
+/**
+ * send the samples of the last run over serial
+ * @return number of samples sent
+ * @note stops a run in progress, and waits on the serial line
+ */
+uint32_t prof_dump(void) {
+    if (prof_running) {
+        prof_stop();
+    }
+
+    char line[32 + PROF_DEPTH * 9];
+    msnprintf(line, sizeof(line), PROF_LINE_PREFIX "begin samples=%u dropped=%u hz=%u depth=%u\n",
+              prof_count, prof_dropped, prof_hz, PROF_DEPTH);
+    prof_send_line(line);
+
+    // s <count> <pc> [<return address> ...], repeats of a stack are sent once
+    uint32_t i = 0;
+    while (i < prof_count) {
+        uint32_t run = 1;
+        while (i + run < prof_count && memcmp(prof_pcs[i], prof_pcs[i + run], sizeof(prof_pcs[i])) == 0) {
+            run++;
+        }
+        int len = msnprintf(line, sizeof(line), PROF_LINE_PREFIX "s %u", run);
+        for (int depth = 0; depth < PROF_DEPTH && prof_pcs[i][depth]; depth++) {
+            len += msnprintf(line + len, (int)sizeof(line) - len, " %08x", prof_pcs[i][depth]);
+        }
+        msnprintf(line + len, (int)sizeof(line) - len, "\n");
+        prof_send_line(line);
+        i += run;
+    }
+    prof_send_line(PROF_LINE_PREFIX "end\n");
+    return prof_count;
+}
+
+void prof_get_stats(prof_stats *stats) {
+    stats->running = prof_running;
+    stats->hz = prof_hz;
+    stats->samples = prof_count;
+    stats->dropped = prof_dropped;
+}
@@ -0,0 +1,105 @@
+/*
+    MooseOS Event tracer
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Tracepoints write fixed-size records into one ring for the whole boot.
+    A slot is claimed with one atomic add, so interrupt handlers can trace
+    while the code they interrupted is tracing too. When the ring wraps
+    the oldest records are overwritten.
+
+    trace_dump sends the ring over serial as text lines. Capture the
+    serial output and convert it with scripts/trace_to_chrome.py.
+*/
+
+#include "trace/trace.h"
+#include "tsc/tsc.h"
+#include "serial/serial.h"
+#include "stdio/stdio.h"
+#include "string/string.h"
+
+#define TRACE_LINE_PREFIX "[TRACE] "
+
+volatile bool trace_enabled = true;
+
+static trace_record trace_ring[TRACE_RECORDS];
+static volatile uint32_t trace_head = 0; // records claimed since boot
+static uint32_t trace_tsc_khz = 0;       // 0 until the TSC has been measured
+
+static const char *trace_event_names[TRACE_EVENT_COUNT] = {
+    [TRACE_TIMER_IRQ]   = "timer_irq",
+    [TRACE_TASK_SWITCH] = "task_switch",
+    [TRACE_DISK_READ]   = "disk_read",
+    [TRACE_DISK_WRITE]  = "disk_write",
+    [TRACE_FS_SAVE]     = "fs_save",
+    [TRACE_IDLE]        = "idle",
+};
+
+void trace_write(uint16_t event, uint8_t phase, uint32_t arg0, uint32_t arg1) {
+    uint32_t index = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    trace_record *record = &trace_ring[index % TRACE_RECORDS];
+    record->tsc = rdtsc();
+    record->event = event;
+    record->phase = phase;
+    record->reserved = 0;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+}
+
+void trace_set_enabled(bool enabled) {
+    trace_enabled = enabled;
+}
+
+/**
+ * tell the dump how fast the TSC runs, so timestamps can become time
+ */
+void trace_set_tsc_khz(uint32_t khz) {
+    trace_tsc_khz = khz;
+}
+
+static void trace_send_line(const char *line) {
+    serial_write_sync(line, strlen(line));
+}
+
+/**
+ * send every record in the ring over serial, oldest first
+ * @return number of records sent
+ * @note waits on the serial line, tracing is paused meanwhile
+ */
+uint32_t trace_dump(void) {
+    bool was_enabled = trace_enabled;
+    trace_enabled = false;
+
+    uint32_t head = trace_head;
+    uint32_t count = head < TRACE_RECORDS ? head : TRACE_RECORDS;
+    char line[96];
+
+    msnprintf(line, sizeof(line), TRACE_LINE_PREFIX "begin records=%u overwritten=%u tsc_khz=%u\n",
+              count, head - count, trace_tsc_khz);
+    trace_send_line(line);
+    for (uint32_t id = 1; id < TRACE_EVENT_COUNT; id++) {
+        msnprintf(line, sizeof(line), TRACE_LINE_PREFIX "event %u %s\n", id, trace_event_names[id]);
+        trace_send_line(line);
+    }
+
+    // r <tsc high> <tsc low> <event> <phase> <arg0> <arg1>
+    for (uint32_t i = head - count; i != head; i++) {
+        const trace_record *record = &trace_ring[i % TRACE_RECORDS];
+        char phase[2] = { (char)record->phase, '\0' }; // msnprintf has no %c
+        msnprintf(line, sizeof(line), TRACE_LINE_PREFIX "r %08x %08x %u %s %08x %08x\n",
+                  (uint32_t)(record->tsc >> 32), (uint32_t)record->tsc,
+                  record->event, phase, record->arg0, record->arg1);
+        trace_send_line(line);
+    }
+    trace_send_line(TRACE_LINE_PREFIX "end\n");
+
+    trace_enabled = was_enabled;
+    return count;
+}
+
+void trace_get_stats(trace_stats *stats) {
+    uint32_t head = trace_head;
+    stats->enabled = trace_enabled;
+    stats->recorded = head;
+    stats->overwritten = head > TRACE_RECORDS ? head - TRACE_RECORDS : 0;
+}
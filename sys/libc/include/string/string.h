@@ -7,6 +7,8 @@
 #define STRING_H_
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #define MAX_NAME_LEN 128
 #define MAX_PARTS 10
@@ -14,8 +16,12 @@
 
 // string function prototypes
 void strcpy(char* dest, const char* src);
+char* strncpy(char* dest, const char* src, size_t n);
 int strcmp(const char* a, const char* b);
+int strncmp(const char* a, const char* b, size_t n);
 size_t strlen(const char* str);
+size_t strnlen(const char* str, size_t max);
+char* strchr(const char* str, int c);
 int strtok(const char *input, char delimiter, char output[MAX_PARTS][MAX_PART_LEN]);
 char* strcat(char* dest, const char* src);
 const char* strip_whitespace(const char* str);
@@ -23,5 +29,9 @@ const char* strip_whitespace(const char* str);
 // memory function prototypes
 void* memcpy(void* dest, const void* src, size_t n);
 void* memset(void* ptr, int value, size_t n);
+void* memmove(void* dest, const void* src, size_t n);
+int memcmp(const void* a, const void* b, size_t n);
+void* memchr(const void* ptr, int c, size_t n);
+bool string_init(void);
 
 #endif // STRING_H_
@@ -5,15 +5,111 @@
 */
 
 #include "string/string.h"
+#include "cpuid/cpuid.h"
+#include "io/io.h"
 
-// copy string from src to dest
-void strcpy(char* dest, const char* src) {
-    int i = 0;
-    while (src[i] && i < MAX_NAME_LEN - 1) {
+/*
+ * the string functions read a word at a time where they can.
+ * word reads are aligned so they never cross into the next page,
+ * even when the string ends right before it.
+ */
+
+#define WORD_ONES  0x01010101u
+#define WORD_HIGHS 0x80808080u
+// nonzero if any byte of the word is zero
+#define HAS_ZERO(w) (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+// unaligned reads must not cross this boundary past the end of a string
+#define STRING_PAGE_SIZE 4096
+
+// lets words be read out of any buffer without breaking aliasing rules
+typedef uint32_t __attribute__((may_alias)) mem_word;
+
+static inline bool word_aligned(const void* ptr) {
+    return ((uintptr_t)ptr & 3) == 0;
+}
+
+// true if both pointers can reach a word boundary together
+static inline bool same_alignment(const void* a, const void* b) {
+    return (((uintptr_t)a ^ (uintptr_t)b) & 3) == 0;
+}
+
+// first word boundary at or below ptr
+static inline const mem_word* word_below(const void* ptr) {
+    return (const mem_word*)((uintptr_t)ptr & ~(uintptr_t)3);
+}
+
+// all ones in the bytes of an aligned word that come before ptr
+static inline uint32_t bytes_before(const void* ptr) {
+    return ((uintptr_t)ptr & 3) ? (1u << (((uintptr_t)ptr & 3) * 8)) - 1 : 0;
+}
+
+// offset of the first byte flagged by HAS_ZERO, bytes above it may be flagged wrongly
+static inline size_t first_flagged(uint32_t flags) {
+    return __builtin_ctz(flags) / 8;
+}
+
+/**
+ * copy a string, stopping after limit characters
+ * @return number of characters copied, dest is always terminated
+ */
+static size_t copy_string(char* dest, const char* src, size_t limit) {
+    size_t i = 0;
+    // one unaligned word takes the source to a word boundary,
+    // as long as it stays within the page the string starts in
+    if (limit >= 4 && ((uintptr_t)src & (STRING_PAGE_SIZE - 1)) <= STRING_PAGE_SIZE - 4) {
+        uint32_t word = *(const mem_word*)src;
+        if (!HAS_ZERO(word)) {
+            *(mem_word*)dest = word;
+            i = 4 - ((uintptr_t)src & 3);
+        }
+    }
+    for (; !word_aligned(src + i); i++) {
+        if (i == limit || !src[i]) {
+            dest[i] = '\0';
+            return i;
+        }
+        dest[i] = src[i];
+    }
+    while (limit - i >= 4) {
+        uint32_t word = *(const mem_word*)(src + i);
+        uint32_t flags = HAS_ZERO(word);
+        if (flags) {
+            size_t len = i + first_flagged(flags);
+            if (len < 4) {
+                break;
+            }
+            // the last word overlaps bytes already copied instead of a byte loop
+            *(mem_word*)(dest + len - 4) = *(const mem_word*)(src + len - 4);
+            dest[len] = '\0';
+            return len;
+        }
+        *(mem_word*)(dest + i) = word;
+        i += 4;
+    }
+    for (; i < limit && src[i]; i++) {
         dest[i] = src[i];
-        i++;
     }
     dest[i] = '\0';
+    return i;
+}
+
+// copy string from src to dest
+/**
+ * @note at most MAX_NAME_LEN - 1 characters are copied, use strncpy for other buffers
+ */
+void strcpy(char* dest, const char* src) {
+    copy_string(dest, src, MAX_NAME_LEN - 1);
+}
+
+// copy at most n characters, the rest of dest is zero filled
+/**
+ * @note like the standard strncpy, dest is not terminated if src has n or more characters
+ */
+char* strncpy(char* dest, const char* src, size_t n) {
+    size_t len = strnlen(src, n);
+    memcpy(dest, src, len);
+    memset(dest + len, 0, n - len);
+    return dest;
 }
 
 // check if two strings are equal
@@ -23,20 +119,103 @@ void strcpy(char* dest, const char* src) {
  *       this function returns 1 for equal, 0 for not equal
  */
 int strcmp(const char* a, const char* b) {
-    int i = 0;
-    while (a[i] && b[i]) {
-        if (a[i] != b[i]) return 0;
-        i++;
+    if (same_alignment(a, b)) {
+        while (!word_aligned(a)) {
+            if (*a != *b) return 0;
+            if (!*a) return 1;
+            a++;
+            b++;
+        }
+        // stop at the first word that differs or ends the string
+        while (1) {
+            uint32_t word = *(const mem_word*)a;
+            if (word != *(const mem_word*)b || HAS_ZERO(word)) {
+                break;
+            }
+            a += 4;
+            b += 4;
+        }
+    }
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// compare at most n characters
+/**
+ * @note unlike strcmp this follows the standard and returns
+ *       <0, 0, >0 for less than, equal, greater than respectively
+ */
+int strncmp(const char* a, const char* b, size_t n) {
+    if (same_alignment(a, b)) {
+        while (n && !word_aligned(a)) {
+            if (*a != *b || !*a) {
+                return (unsigned char)*a - (unsigned char)*b;
+            }
+            a++;
+            b++;
+            n--;
+        }
+        while (n >= 4) {
+            uint32_t word = *(const mem_word*)a;
+            if (word != *(const mem_word*)b || HAS_ZERO(word)) {
+                break;
+            }
+            a += 4;
+            b += 4;
+            n -= 4;
+        }
     }
-    return a[i] == b[i];
+    while (n) {
+        if (*a != *b || !*a) {
+            return (unsigned char)*a - (unsigned char)*b;
+        }
+        a++;
+        b++;
+        n--;
+    }
+    return 0;
 }
 
 // get length of string
 size_t strlen(const char* str) {
-    size_t len = 0;
-    while (str[len])
-        len++;
-    return len;
+    const mem_word* p = word_below(str);
+    // the bytes before the string are forced nonzero
+    uint32_t word = *p | bytes_before(str);
+    uint32_t flags = HAS_ZERO(word);
+    while (!flags) {
+        uint32_t word = *++p;
+        flags = HAS_ZERO(word);
+    }
+    return (const char*)p + first_flagged(flags) - str;
+}
+
+// get length of string, looking at no more than max characters
+size_t strnlen(const char* str, size_t max) {
+    const char* end = memchr(str, '\0', max);
+    return end ? (size_t)(end - str) : max;
+}
+
+// find the first c in a string
+/**
+ * @return pointer to the character, the terminator if c is '\0', NULL if not found
+ */
+char* strchr(const char* str, int c) {
+    char ch = (char)c;
+    uint32_t pattern = (unsigned char)ch * WORD_ONES;
+    const mem_word* p = word_below(str);
+    uint32_t head = bytes_before(str);
+    // flag the terminator and the character, the first flag decides
+    uint32_t word = *p;
+    uint32_t flags = HAS_ZERO(word | head) | HAS_ZERO((word ^ pattern) | head);
+    while (!flags) {
+        word = *++p;
+        flags = HAS_ZERO(word) | HAS_ZERO(word ^ pattern);
+    }
+    const char* found = (const char*)p + first_flagged(flags);
+    return *found == ch ? (char*)found : NULL;
 }
 
 // split string by delimiter
@@ -66,19 +245,7 @@ int strtok(const char *input, char delimiter, char output[MAX_PARTS][MAX_PART_LE
 
 // concat strings
 char* strcat(char* dest, const char* src) {
-    int dest_len = 0;
-    while (dest[dest_len] != '\0') {
-        dest_len++;
-    }
-    
-    int i = 0;
-    while (src[i] != '\0') {
-        dest[dest_len + i] = src[i];
-        i++;
-    }
-    
-    dest[dest_len + i] = '\0';
-    
+    copy_string(dest + strlen(dest), src, (size_t)-1);
     return dest;
 }
 
@@ -112,21 +279,271 @@ const char* strip_whitespace(const char* str) {
     return trimmed;
 }
 
-// memory copy function
-void* memcpy(void* dest, const void* src, size_t n) {
+/*
+ * memory functions
+ * the word variants work on any x86, the SSE2 variants take over for
+ * large sizes once string_init has found SSE2
+ */
+
+// from this size copies and fills use non-temporal stores,
+// the data is unlikely to be read back before it leaves the cache anyway
+#define MEM_STREAM_MIN 16384
+// from this size memcmp compares 16 bytes at a time
+#define MEM_COMPARE_MIN 64
+// SSE2 loops run with interrupts off since interrupt handlers do not
+// save the XMM registers, this bounds how long they stay off.
+// backward copies hold them off for as long too
+#define MEM_SSE_CHUNK 4096
+
+static void copy_words(void* dest, const void* src, size_t n) {
+    size_t words = n / 4;
+    size_t bytes = n % 4;
+    asm volatile("rep movsl" : "+D"(dest), "+S"(src), "+c"(words) : : "memory");
+    asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(bytes) : : "memory");
+}
+
+/**
+ * copy from the end down, for a destination that overlaps the source from above
+ * @note interrupt handlers assume the direction flag is clear, so interrupts
+ *       stay off while it is set, a chunk at a time like the SSE2 loops
+ */
+static void copy_words_backward(void* dest, const void* src, size_t n) {
+    char* d = (char*)dest + n - 1;
+    const char* s = (const char*)src + n - 1;
+    size_t bytes = n % 4;
+    size_t words = n / 4;
+    // the bytes past the last whole word go first
+    unsigned long flags = irq_save();
+    asm volatile("std\n\trep movsb\n\tcld" : "+D"(d), "+S"(s), "+c"(bytes) : : "memory");
+    irq_restore(flags);
+    d -= 3;
+    s -= 3;
+    while (words) {
+        size_t chunk = words < MEM_SSE_CHUNK / 4 ? words : MEM_SSE_CHUNK / 4;
+        words -= chunk;
+        flags = irq_save();
+        asm volatile("std\n\trep movsl\n\tcld" : "+D"(d), "+S"(s), "+c"(chunk) : : "memory");
+        irq_restore(flags);
+    }
+}
+
+static void fill_words(void* ptr, uint32_t pattern, size_t n) {
+    size_t words = n / 4;
+    size_t bytes = n % 4;
+    asm volatile("rep stosl" : "+D"(ptr), "+c"(words) : "a"(pattern) : "memory");
+    asm volatile("rep stosb" : "+D"(ptr), "+c"(bytes) : "a"(pattern) : "memory");
+}
+
+static int compare_words(const unsigned char* a, const unsigned char* b, size_t n) {
+    // skip equal words, the difference is then found byte by byte
+    while (n >= 4 && *(const mem_word*)a == *(const mem_word*)b) {
+        a += 4;
+        b += 4;
+        n -= 4;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i]) {
+            return a[i] - b[i];
+        }
+    }
+    return 0;
+}
+
+/**
+ * number of bytes up to the next 16 byte boundary, capped at n
+ */
+static inline size_t align16_head(const void* ptr, size_t n) {
+    size_t head = (16 - ((uintptr_t)ptr & 15)) & 15;
+    return head < n ? head : n;
+}
+
+__attribute__((target("sse2")))
+static void copy_stream(void* dest, const void* src, size_t n) {
     char* d = (char*)dest;
     const char* s = (const char*)src;
-    for (size_t i = 0; i < n; i++) {
-        d[i] = s[i];
+
+    // movntdq needs an aligned destination, the source is read unaligned
+    size_t head = align16_head(d, n);
+    copy_words(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    while (n >= 64) {
+        size_t chunk = n < MEM_SSE_CHUNK ? n & ~(size_t)63 : MEM_SSE_CHUNK;
+        unsigned long flags = irq_save();
+        for (size_t i = 0; i < chunk; i += 64) {
+            asm volatile("movdqu 0(%1), %%xmm0\n\t"
+                         "movdqu 16(%1), %%xmm1\n\t"
+                         "movdqu 32(%1), %%xmm2\n\t"
+                         "movdqu 48(%1), %%xmm3\n\t"
+                         "movntdq %%xmm0, 0(%0)\n\t"
+                         "movntdq %%xmm1, 16(%0)\n\t"
+                         "movntdq %%xmm2, 32(%0)\n\t"
+                         "movntdq %%xmm3, 48(%0)"
+                         : : "r"(d + i), "r"(s + i)
+                         : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+        }
+        // non-temporal stores are weakly ordered, make them visible before returning
+        asm volatile("sfence" : : : "memory");
+        irq_restore(flags);
+        d += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+    copy_words(d, s, n);
+}
+
+__attribute__((target("sse2")))
+static void fill_stream(void* ptr, uint32_t pattern, size_t n) {
+    char* p = (char*)ptr;
+
+    size_t head = align16_head(p, n);
+    fill_words(p, pattern, head);
+    p += head;
+    n -= head;
+
+    while (n >= 64) {
+        size_t chunk = n < MEM_SSE_CHUNK ? n & ~(size_t)63 : MEM_SSE_CHUNK;
+        unsigned long flags = irq_save();
+        asm volatile("movd %0, %%xmm0\n\t"
+                     "pshufd $0, %%xmm0, %%xmm0"
+                     : : "r"(pattern) : "xmm0");
+        for (size_t i = 0; i < chunk; i += 64) {
+            asm volatile("movntdq %%xmm0, 0(%0)\n\t"
+                         "movntdq %%xmm0, 16(%0)\n\t"
+                         "movntdq %%xmm0, 32(%0)\n\t"
+                         "movntdq %%xmm0, 48(%0)"
+                         : : "r"(p + i) : "memory");
+        }
+        asm volatile("sfence" : : : "memory");
+        irq_restore(flags);
+        p += chunk;
+        n -= chunk;
+    }
+    fill_words(p, pattern, n);
+}
+
+__attribute__((target("sse2")))
+static int compare_sse2(const unsigned char* a, const unsigned char* b, size_t n) {
+    while (n >= 16) {
+        size_t chunk = n < MEM_SSE_CHUNK ? n & ~(size_t)15 : MEM_SSE_CHUNK;
+        uint32_t mask = 0xFFFF;
+        size_t i;
+        unsigned long flags = irq_save();
+        for (i = 0; i < chunk; i += 16) {
+            asm volatile("movdqu (%1), %%xmm0\n\t"
+                         "movdqu (%2), %%xmm1\n\t"
+                         "pcmpeqb %%xmm1, %%xmm0\n\t"
+                         "pmovmskb %%xmm0, %0"
+                         : "=r"(mask) : "r"(a + i), "r"(b + i)
+                         : "memory", "xmm0", "xmm1");
+            if (mask != 0xFFFF) {
+                break;
+            }
+        }
+        irq_restore(flags);
+        a += i;
+        b += i;
+        n -= i;
+        if (mask != 0xFFFF) {
+            break; // the difference is in the next 16 bytes
+        }
+    }
+    return compare_words(a, b, n);
+}
+
+// variants for large sizes, picked by string_init
+static void (*copy_large)(void*, const void*, size_t) = copy_words;
+static void (*fill_large)(void*, uint32_t, size_t) = fill_words;
+static int (*compare_large)(const unsigned char*, const unsigned char*, size_t) = compare_words;
+
+/**
+ * pick the memory function variants for this CPU, call once at boot
+ * @return true if the SSE2 variants are in use
+ */
+bool string_init(void) {
+    if (!cpu_enable_sse()) {
+        return false;
+    }
+    copy_large = copy_stream;
+    fill_large = fill_stream;
+    compare_large = compare_sse2;
+    return true;
+}
+
+// memory copy function
+void* memcpy(void* dest, const void* src, size_t n) {
+    if (n >= MEM_STREAM_MIN) {
+        copy_large(dest, src, n);
+    } else {
+        copy_words(dest, src, n);
     }
     return dest;
 }
 
 // memset function
 void* memset(void* ptr, int value, size_t n) {
-    unsigned char* p = (unsigned char*)ptr;
-    for (size_t i = 0; i < n; i++) {
-        p[i] = (unsigned char)value;
+    uint32_t pattern = (unsigned char)value * 0x01010101u;
+    if (n >= MEM_STREAM_MIN) {
+        fill_large(ptr, pattern, n);
+    } else {
+        fill_words(ptr, pattern, n);
     }
     return ptr;
-}
\ No newline at end of file
+}
+
+// memory copy that allows the buffers to overlap
+void* memmove(void* dest, const void* src, size_t n) {
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
+    if (d == s || n == 0) {
+        return dest;
+    }
+    // a forward copy never overwrites source bytes it has yet to read
+    // unless the destination starts inside the source
+    if (d < s || d >= s + n) {
+        return memcpy(dest, src, n);
+    }
+    copy_words_backward(dest, src, n);
+    return dest;
+}
+
+// compare memory
+/**
+ * @note unlike strcmp this follows the standard and returns
+ *       <0, 0, >0 for less than, equal, greater than respectively
+ */
+int memcmp(const void* a, const void* b, size_t n) {
+    if (n >= MEM_COMPARE_MIN) {
+        return compare_large(a, b, n);
+    }
+    return compare_words(a, b, n);
+}
+
+// find the first c in the first n bytes
+/**
+ * @return pointer to the byte, NULL if not found
+ */
+void* memchr(const void* ptr, int c, size_t n) {
+    if (n == 0) {
+        return NULL;
+    }
+    uint32_t pattern = (unsigned char)c * WORD_ONES;
+    const mem_word* p = word_below(ptr);
+    // bytes left counting from p, the last word may run past the end
+    size_t left = (uintptr_t)ptr - (uintptr_t)p;
+    left = n > (size_t)-1 - left ? (size_t)-1 : n + left;
+    uint32_t word = (*p ^ pattern) | bytes_before(ptr);
+    uint32_t flags = HAS_ZERO(word);
+    while (!flags) {
+        if (left <= 4) {
+            return NULL;
+        }
+        left -= 4;
+        word = *++p ^ pattern;
+        flags = HAS_ZERO(word);
+    }
+    size_t offset = first_flagged(flags);
+    return offset < left ? (char*)p + offset : NULL;
+}
@@ -0,0 +1,33 @@
+/*
+    MooseOS Arena allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// build with -DARENA_DEBUG to poison released memory and log new peaks
+
+// bump allocator over a fixed buffer, released all at once
+typedef struct {
+    const char *name;
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    size_t peak;    // high-water mark of used
+} arena;
+
+// position to roll an arena back to
+typedef size_t arena_mark;
+
+void arena_init(arena *a, const char *name, void *buffer, size_t size);
+void *arena_alloc(arena *a, size_t size);
+arena_mark arena_save(arena *a);
+void arena_restore(arena *a, arena_mark mark);
+void arena_reset(arena *a);
+
+#endif // ARENA_H
@@ -0,0 +1,45 @@
+/*
+    MooseOS Physical frame allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// frames are 4KB, blocks of 2^order frames are handed out
+#define FRAME_SIZE          4096
+#define FRAME_MAX_ORDER     10          // 4MB blocks
+#define FRAME_MAX_MEMORY    0x40000000  // 1GB of physical memory at most
+#define FRAME_MAX_COUNT     (FRAME_MAX_MEMORY / FRAME_SIZE)
+
+// frame allocator statistics
+typedef struct {
+    uint32_t total_frames;  // frames managed by the allocator
+    uint32_t free_frames;   // frames currently free
+    uint32_t used_frames;   // frames currently allocated
+    uint32_t free_blocks[FRAME_MAX_ORDER + 1]; // free blocks per order
+} frame_stats;
+
+// setup
+void frame_add_region(uint32_t start, uint32_t end);
+
+// allocation
+uint32_t frame_alloc_order(uint32_t order);
+void frame_free_block(uint32_t addr);
+uint32_t frame_order_for_size(uint32_t size);
+
+// queries
+bool frame_is_allocated(uint32_t addr);
+
+// sharing single frames between mappings
+void frame_ref(uint32_t addr);
+void frame_unref(uint32_t addr);
+uint32_t frame_ref_count(uint32_t addr);
+uint32_t frame_free_count(void);
+uint32_t frame_used_count(void);
+void frame_get_stats(frame_stats *stats);
+
+#endif // FRAME_H
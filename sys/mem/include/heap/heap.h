@@ -7,12 +7,72 @@
 #define MALLOC_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// subsystem tags for heap accounting, plain kmalloc counts as HEAP_TAG_KERNEL.
+// the editor and terminal work in fixed buffers, the segment list the
+// terminal's elf command frees is counted as HEAP_TAG_ELF by elf_parse
+typedef enum {
+  HEAP_TAG_KERNEL,
+  HEAP_TAG_FILESYSTEM,
+  HEAP_TAG_ELF,
+  HEAP_TAG_COUNT
+} heap_tag;
+
+// heap fragmentation statistics
+typedef struct {
+  size_t heap_size;       // bytes currently backed by frames
+  size_t total_free;      // free bytes, including the unused middle of the heap
+  size_t largest_free;    // largest contiguous free extent
+  size_t free_blocks;     // number of free blocks in the block list
+} heap_stats;
+
+// allocation accounting for one tag
+typedef struct {
+  const char *name;
+  size_t live_bytes;      // usable bytes currently allocated
+  size_t peak_bytes;      // high-water mark of live_bytes
+  uint32_t allocations;   // successful allocations so far
+  uint32_t failures;      // allocations that returned NULL
+} heap_tag_stats;
+
+// a shrinker frees cached memory, it gets the bytes wanted and returns the bytes freed
+typedef size_t (*heap_shrinker_fn)(size_t wanted);
+
+#define HEAP_SHRINKER_MAX 4
+
+// what one shrinker has given back
+typedef struct {
+  const char *name;
+  uint32_t calls;         // times it was asked for memory
+  size_t reclaimed_bytes; // bytes it freed over all calls
+} heap_shrinker_stats;
 
 // memory allocation functions
 void *kmalloc(size_t size);
+void *kmalloc_tagged(size_t size, heap_tag tag);
 void kfree(void *ptr);
 void *kcalloc(size_t nelem, size_t elsize);
 void *krealloc(void *ptr, size_t size);
 void *nofree_malloc(size_t size);
+void heap_set_limit(size_t limit);
+void heap_get_stats(heap_stats *stats);
+void heap_get_tag_stats(heap_tag tag, heap_tag_stats *stats);
+
+// reclaiming memory under pressure
+bool heap_register_shrinker(const char *name, heap_shrinker_fn shrink);
+uint32_t heap_shrinker_count(void);
+void heap_get_shrinker_stats(uint32_t index, heap_shrinker_stats *stats);
+
+// tag accounting, for allocators that sit on top of the heap
+void heap_tag_alloc(heap_tag tag, size_t size);
+void heap_tag_free(heap_tag tag, size_t size);
+void heap_tag_fail(heap_tag tag);
+
+// page-granular backing for the slab allocator
+void *heap_page_alloc(void);
+void heap_page_free(void *page);
+bool heap_is_page(void *ptr);
 
 #endif // MALLOC_H
\ No newline at end of file
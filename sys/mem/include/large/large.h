@@ -0,0 +1,31 @@
+/*
+    MooseOS Large object allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef LARGE_H
+#define LARGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "heap/heap.h"
+
+// kmalloc requests above this many bytes get pages of their own
+#define LARGE_MIN_SIZE      2048
+
+typedef struct {
+    uint32_t objects;           // live large objects
+    uint32_t pages;             // pages held by live objects
+    uint32_t peak_pages;        // high-water mark of pages
+} large_stats;
+
+void *large_alloc(size_t size, heap_tag tag);
+void large_free(void *ptr);
+bool large_resize(void *ptr, size_t size);
+bool large_owns(void *ptr);
+size_t large_object_size(void *ptr);
+heap_tag large_object_tag(void *ptr);
+void large_get_stats(large_stats *stats);
+
+#endif // LARGE_H
@@ -0,0 +1,27 @@
+/*
+    MooseOS Physical memory map
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef MEMMAP_H
+#define MEMMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MEMMAP_MAX_REGIONS  32
+#define MEMMAP_DEFAULT_END  0x01000000  // 16MB, assumed when the bootloader gives no map
+
+// a range of usable RAM, end is exclusive
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+} memmap_region;
+
+void memmap_add_usable(uint32_t start, uint32_t end);
+const memmap_region *memmap_regions(uint32_t *count);
+uint32_t memmap_end(void);
+uint32_t memmap_usable_bytes(void);
+
+#endif // MEMMAP_H
@@ -20,14 +20,29 @@
 #define PAGE_PRESENT    0x001   // page is present in memory
 #define PAGE_WRITABLE   0x002   // page is writable
 #define PAGE_USER       0x004   // page is accessible from user mode
+#define PAGE_NO_CACHE   0x010   // accesses go straight to memory, for device registers
 #define PAGE_ACCESSED   0x020   // page has been accessed
 #define PAGE_DIRTY      0x040   // page has been written to
+#define PAGE_LARGE      0x080   // directory entry maps a 4MB page (needs CR4.PSE)
+#define PAGE_GLOBAL     0x100   // mapping survives CR3 reloads (needs CR4.PGE)
+#define PAGE_COW        0x200   // read-only share of a writable page, copied on write
+#define PAGE_OWNED      0x400   // the mapping holds a reference to its frame
+
+#define LARGE_PAGE_SIZE 0x400000
 
 // memory layout
 #define KERNEL_START        0x00100000  // 1MB - where kernel is loaded
 #define KERNEL_END          0x00400000  // 4MB - end of kernel space
 #define USER_START          0x40000000  // 1GB - start of user space
 #define PAGE_TABLE_START    0x00400000  // 4MB - where page tables begin
+#ifndef KERNEL_HEAP_START // the host heap benchmark points this at its own arena
+#define KERNEL_HEAP_START   0xD0000000  // reserved virtual range for the kernel heap
+#endif
+#define KERNEL_HEAP_SIZE    0x10000000  // 256MB, backed by frames on demand
+#ifndef KERNEL_LARGE_START
+#define KERNEL_LARGE_START  0xE0000000  // reserved virtual range for page-sized heap objects
+#endif
+#define KERNEL_LARGE_SIZE   0x10000000  // 256MB, frames are returned when objects are freed
 
 // macros
 #define PAGE_ALIGN_DOWN(addr)   ((addr) & ~(PAGE_SIZE - 1))
@@ -62,6 +77,7 @@ page_table_t *create_page_table(uint32_t virtual_addr, page_directory_t *dir);
 bool map_page(uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags, page_directory_t *dir);
 bool unmap_page(uint32_t virtual_addr, page_directory_t *dir);
 uint32_t get_physical_addr(uint32_t virtual_addr, page_directory_t *dir);
+bool paging_map_identity(uint32_t start, uint32_t size, uint32_t flags);
 
 // frame allocation
 uint32_t alloc_frame(void);
@@ -76,9 +92,38 @@ void kfree_aligned(void *ptr);
 // TLB management
 void flush_tlb(void);
 void flush_tlb_entry(uint32_t virtual_addr);
+uint32_t paging_global_flag(void);
+
+// page fault error code bits
+#define PAGE_FAULT_PRESENT  0x1     // the page was present, so this is a protection fault
+#define PAGE_FAULT_WRITE    0x2     // the access was a write
+#define PAGE_FAULT_USER     0x4     // the access came from user mode
+
+// at most this many reserved ranges at a time
+#define MAX_RESERVED_REGIONS 16
+// address spaces that copy-on-write breaks are counted for
+#define MAX_ADDRESS_SPACES   16
+
+typedef struct {
+    uint32_t minor_faults;      // faults served with a zeroed frame
+    uint32_t failed_faults;     // faults outside any reserved range, or out of frames
+    uint64_t total_cycles;      // time spent serving minor faults
+    uint32_t max_cycles;        // slowest minor fault
+    uint32_t cow_breaks;        // writes to copy-on-write pages
+} page_fault_stats;
+
+// demand paging
+bool paging_reserve(uint32_t start, uint32_t size, uint32_t flags, page_directory_t *dir);
+void paging_release(uint32_t start, page_directory_t *dir);
+void paging_discard(uint32_t start, uint32_t size, page_directory_t *dir);
+bool paging_commit(uint32_t start, uint32_t pages, page_directory_t *dir);
+uint32_t paging_committed_pages(void);
+uint32_t paging_reserved_pages(uint32_t start, page_directory_t *dir);
+void paging_get_fault_stats(page_fault_stats *stats);
+uint32_t paging_cow_breaks(page_directory_t *dir);
 
 // page fault handling
-void page_fault_handler(uint32_t error_code, uint32_t virtual_addr);
+bool page_fault_handler(uint32_t error_code, uint32_t virtual_addr);
 
 // identity mapping for kernel
 void identity_map_kernel(page_directory_t *dir);
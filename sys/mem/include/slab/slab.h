@@ -0,0 +1,52 @@
+/*
+    MooseOS Slab allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "heap/heap.h"
+
+// size classes are powers of two from 16 to 1024 bytes
+#define SLAB_MIN_SHIFT      4
+#define SLAB_MAX_SHIFT      10
+#define SLAB_CLASS_COUNT    (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define SLAB_MIN_SIZE       (1 << SLAB_MIN_SHIFT)
+#define SLAB_MAX_SIZE       (1 << SLAB_MAX_SHIFT)
+
+// each slab is one heap page with this header at the start
+#define SLAB_MAGIC          0x51AB51AB
+
+// most named object caches that can exist at once
+#define KMEM_CACHE_MAX      8
+
+typedef struct kmem_cache kmem_cache;
+typedef void (*kmem_ctor_t)(void *object);
+
+// per cache statistics
+typedef struct {
+    const char *name;
+    size_t object_size;         // bytes per object, including padding
+    uint32_t objects_in_use;
+    uint32_t objects_total;     // objects that fit in the cache's pages
+    uint32_t pages;
+} kmem_cache_stats;
+
+// small object allocation
+void *slab_alloc(size_t size, heap_tag tag);
+void slab_free(void *ptr);
+size_t slab_object_size(void *ptr);
+heap_tag slab_object_tag(void *ptr);
+
+// object caches
+kmem_cache *kmem_cache_create(const char *name, size_t size, kmem_ctor_t ctor,
+                              kmem_ctor_t dtor, heap_tag tag);
+void *kmem_cache_alloc(kmem_cache *cache);
+void kmem_cache_free(kmem_cache *cache, void *ptr);
+void kmem_cache_get_stats(kmem_cache *cache, kmem_cache_stats *stats);
+
+#endif // SLAB_H
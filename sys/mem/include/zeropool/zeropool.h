@@ -0,0 +1,26 @@
+/*
+    MooseOS Pre-zeroed frame pool
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+
+#ifndef ZEROPOOL_H
+#define ZEROPOOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ZERO_POOL_SIZE      32  // frames kept zeroed ahead of time
+#define ZERO_POOL_BATCH     4   // frames zeroed per idle pass
+
+typedef struct {
+    uint32_t ready;     // zeroed frames waiting in the pool
+    uint32_t hits;      // allocations served from the pool
+    uint32_t misses;    // allocations that had to zero a frame on the spot
+} zero_pool_stats;
+
+uint32_t zero_pool_alloc(void);
+bool zero_pool_refill(uint32_t budget);
+void zero_pool_get_stats(zero_pool_stats *stats);
+
+#endif // ZEROPOOL_H
@@ -0,0 +1,84 @@
+/*
+    MooseOS Arena allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Scratch memory for work that ends at a known point, like one shell
+    command or one redraw. Allocating bumps a pointer, and everything
+    is released in O(1) by moving the pointer back, so short-lived
+    buffers never touch or fragment the heap.
+*/
+
+#include "arena/arena.h"
+#include "print/debug.h"
+#include "string/string.h"
+#include "stdio/stdio.h"
+
+#define ARENA_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+/**
+ * set up an arena over caller owned memory
+ * @param name shown in debug output
+ * @param buffer backing memory, usually a static array
+ * @param size size of buffer in bytes
+ */
+void arena_init(arena *a, const char *name, void *buffer, size_t size) {
+    a->name = name;
+    a->base = (uint8_t*)buffer;
+    a->size = size;
+    a->used = 0;
+    a->peak = 0;
+}
+
+/**
+ * allocate scratch memory, 8 byte aligned
+ * @return pointer to the memory, or NULL if the arena is full
+ */
+void *arena_alloc(arena *a, size_t size) {
+    size = ARENA_ALIGN(size);
+    if (size > a->size - a->used) {
+        debugf("[ARENA] Out of scratch memory\n");
+        return NULL;
+    }
+
+    void *ptr = a->base + a->used;
+    a->used += size;
+    if (a->used > a->peak) {
+        a->peak = a->used;
+#ifdef ARENA_DEBUG
+        char line[64];
+        msnprintf(line, sizeof(line), "[ARENA] %s peak %u/%u bytes\n",
+                  a->name, (uint32_t)a->peak, (uint32_t)a->size);
+        debugf(line);
+#endif
+    }
+    return ptr;
+}
+
+/**
+ * @return the current position, for arena_restore
+ */
+arena_mark arena_save(arena *a) {
+    return a->used;
+}
+
+/**
+ * release everything allocated since mark was saved
+ */
+void arena_restore(arena *a, arena_mark mark) {
+    if (mark > a->used) {
+        return; // mark is from a later point, nothing to release
+    }
+#ifdef ARENA_DEBUG
+    // catch anyone still holding released memory
+    memset(a->base + mark, 0xCC, a->used - mark);
+#endif
+    a->used = mark;
+}
+
+/**
+ * release everything in the arena
+ */
+void arena_reset(arena *a) {
+    arena_restore(a, 0);
+}
@@ -0,0 +1,276 @@
+/*
+    MooseOS Physical frame allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    A buddy allocator over a bitmap of physical frames.
+    The bitmap has one bit per frame (1 = allocated or not RAM),
+    free blocks of 2^order frames sit on one list per order.
+    The list nodes live inside the free frames themselves,
+    which works because physical memory is identity mapped.
+*/
+
+#include "frame/frame.h"
+#include "print/debug.h"
+
+#define FRAME_FREE_MAGIC 0xF4EEB10C
+#define FRAME_REFS_PINNED 0xFF // too many sharers to count, the frame is never freed
+
+// list node stored at the start of every free block
+struct free_block {
+    uint32_t magic;
+    uint32_t order;
+    struct free_block *next;
+    struct free_block *prev;
+};
+
+static uint32_t frame_bitmap[FRAME_MAX_COUNT / 32];
+static uint8_t frame_order[FRAME_MAX_COUNT]; // order of allocated blocks, by first frame
+static uint8_t frame_refs[FRAME_MAX_COUNT];  // extra mappings of a shared frame
+static struct free_block *free_lists[FRAME_MAX_ORDER + 1];
+
+static bool frame_ready = false;
+static uint32_t total_frames = 0;
+static uint32_t free_frames = 0;
+
+static inline bool bitmap_test(uint32_t index) {
+    return frame_bitmap[index / 32] & (1u << (index % 32));
+}
+
+/**
+ * set or clear a run of bits, whole words at a time where possible
+ */
+static void bitmap_fill(uint32_t index, uint32_t count, bool allocated) {
+    while (count && (index % 32)) {
+        if (allocated) frame_bitmap[index / 32] |= (1u << (index % 32));
+        else frame_bitmap[index / 32] &= ~(1u << (index % 32));
+        index++;
+        count--;
+    }
+    while (count >= 32) {
+        frame_bitmap[index / 32] = allocated ? 0xFFFFFFFF : 0;
+        index += 32;
+        count -= 32;
+    }
+    while (count) {
+        if (allocated) frame_bitmap[index / 32] |= (1u << (index % 32));
+        else frame_bitmap[index / 32] &= ~(1u << (index % 32));
+        index++;
+        count--;
+    }
+}
+
+static inline struct free_block *block_at(uint32_t index) {
+    return (struct free_block*)(index * FRAME_SIZE);
+}
+
+static void free_list_push(uint32_t index, uint32_t order) {
+    struct free_block *block = block_at(index);
+    block->magic = FRAME_FREE_MAGIC;
+    block->order = order;
+    block->prev = NULL;
+    block->next = free_lists[order];
+    if (block->next) {
+        block->next->prev = block;
+    }
+    free_lists[order] = block;
+}
+
+static void free_list_remove(struct free_block *block) {
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        free_lists[block->order] = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+    block->magic = 0;
+}
+
+/**
+ * put a block back and merge it with its buddies while they are free
+ */
+static void buddy_release(uint32_t index, uint32_t order) {
+    bitmap_fill(index, 1u << order, false);
+
+    while (order < FRAME_MAX_ORDER) {
+        uint32_t buddy = index ^ (1u << order);
+        if (buddy >= FRAME_MAX_COUNT || bitmap_test(buddy)) {
+            break; // buddy is in use or not RAM
+        }
+        struct free_block *buddy_block = block_at(buddy);
+        if (buddy_block->magic != FRAME_FREE_MAGIC || buddy_block->order != order) {
+            break; // buddy is split into smaller free blocks
+        }
+        free_list_remove(buddy_block);
+        index &= ~(1u << order);
+        order++;
+    }
+
+    free_list_push(index, order);
+}
+
+/**
+ * hand a range of physical memory to the allocator
+ * @param start first byte of the range
+ * @param end first byte after the range
+ */
+void frame_add_region(uint32_t start, uint32_t end) {
+    if (!frame_ready) {
+        // everything is unusable until a region says otherwise
+        bitmap_fill(0, FRAME_MAX_COUNT, true);
+        frame_ready = true;
+    }
+
+    if (end > FRAME_MAX_MEMORY || end < start) {
+        end = FRAME_MAX_MEMORY;
+    }
+    uint32_t index = (start + FRAME_SIZE - 1) / FRAME_SIZE;
+    uint32_t last = end / FRAME_SIZE;
+
+    while (index < last) {
+        // largest block that is aligned and still fits
+        uint32_t order = 0;
+        while (order < FRAME_MAX_ORDER
+               && !(index & ((2u << order) - 1))
+               && index + (2u << order) <= last) {
+            order++;
+        }
+        buddy_release(index, order);
+        total_frames += 1u << order;
+        free_frames += 1u << order;
+        index += 1u << order;
+    }
+}
+
+/**
+ * allocate 2^order physically contiguous frames
+ * @return physical address of the first frame, or 0 if none are free
+ */
+uint32_t frame_alloc_order(uint32_t order) {
+    if (order > FRAME_MAX_ORDER) {
+        return 0;
+    }
+
+    // find the smallest free block that is big enough
+    uint32_t current = order;
+    while (current <= FRAME_MAX_ORDER && !free_lists[current]) {
+        current++;
+    }
+    if (current > FRAME_MAX_ORDER) {
+        debugf("[FRAME] Out of physical frames\n");
+        return 0;
+    }
+
+    struct free_block *block = free_lists[current];
+    free_list_remove(block);
+    uint32_t index = (uint32_t)block / FRAME_SIZE;
+
+    // split it down, the upper halves go back on the lists
+    while (current > order) {
+        current--;
+        free_list_push(index + (1u << current), current);
+    }
+
+    bitmap_fill(index, 1u << order, true);
+    frame_order[index] = order;
+    frame_refs[index] = 0;
+    free_frames -= 1u << order;
+    return index * FRAME_SIZE;
+}
+
+/**
+ * free a block returned by frame_alloc_order
+ * @param addr physical address of the first frame
+ */
+void frame_free_block(uint32_t addr) {
+    uint32_t index = addr / FRAME_SIZE;
+    if (addr % FRAME_SIZE || index >= FRAME_MAX_COUNT || !bitmap_test(index)) {
+        debugf("[FRAME] Invalid frame to free\n");
+        return;
+    }
+
+    uint32_t order = frame_order[index];
+    free_frames += 1u << order;
+    buddy_release(index, order);
+}
+
+/**
+ * @return smallest order whose block holds size bytes,
+ *         FRAME_MAX_ORDER + 1 if no block is big enough
+ */
+uint32_t frame_order_for_size(uint32_t size) {
+    uint32_t order = 0;
+    while (order <= FRAME_MAX_ORDER && (uint32_t)(FRAME_SIZE << order) < size) {
+        order++;
+    }
+    return order;
+}
+
+bool frame_is_allocated(uint32_t addr) {
+    uint32_t index = addr / FRAME_SIZE;
+    return index < FRAME_MAX_COUNT && bitmap_test(index);
+}
+
+/**
+ * add a mapping to a single allocated frame
+ */
+void frame_ref(uint32_t addr) {
+    uint32_t index = addr / FRAME_SIZE;
+    if (index >= FRAME_MAX_COUNT || !bitmap_test(index)) {
+        debugf("[FRAME] Invalid frame to share\n");
+        return;
+    }
+    if (frame_refs[index] != FRAME_REFS_PINNED) {
+        frame_refs[index]++;
+    }
+}
+
+/**
+ * drop a mapping of a single frame, the last one frees it
+ */
+void frame_unref(uint32_t addr) {
+    uint32_t index = addr / FRAME_SIZE;
+    if (index >= FRAME_MAX_COUNT || !bitmap_test(index)) {
+        debugf("[FRAME] Invalid frame to unshare\n");
+        return;
+    }
+    if (frame_refs[index] == 0) {
+        frame_free_block(addr);
+    } else if (frame_refs[index] != FRAME_REFS_PINNED) {
+        frame_refs[index]--;
+    }
+}
+
+/**
+ * @return number of mappings of an allocated frame
+ */
+uint32_t frame_ref_count(uint32_t addr) {
+    uint32_t index = addr / FRAME_SIZE;
+    if (index >= FRAME_MAX_COUNT || !bitmap_test(index)) {
+        return 0;
+    }
+    return frame_refs[index] + 1;
+}
+
+uint32_t frame_free_count(void) {
+    return free_frames;
+}
+
+uint32_t frame_used_count(void) {
+    return total_frames - free_frames;
+}
+
+void frame_get_stats(frame_stats *stats) {
+    stats->total_frames = total_frames;
+    stats->free_frames = free_frames;
+    stats->used_frames = total_frames - free_frames;
+    for (uint32_t order = 0; order <= FRAME_MAX_ORDER; order++) {
+        uint32_t count = 0;
+        for (struct free_block *block = free_lists[order]; block; block = block->next) {
+            count++;
+        }
+        stats->free_blocks[order] = count;
+    }
+}
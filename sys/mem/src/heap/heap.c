@@ -5,36 +5,185 @@
 */
 
 #include "heap/heap.h"
+#include "slab/slab.h"
+#include "large/large.h"
+#include "paging/paging.h"
 #include "string/string.h"
 #include "assert/assert.h"
 
-static char kernel_heap[1024 * 1024]; // 1MB heap
+#define HEAP_SIZE KERNEL_HEAP_SIZE
+
+#ifdef HEAP_TRACE
+#include "stdio/stdio.h"
+#include "print/debug.h"
+
+/**
+ * log one heap call to serial in the trace format read by
+ * scripts/bench/heap_bench.c (build with -DHEAP_TRACE to capture)
+ */
+static void heap_trace(char op, void *ptr, void *new_ptr, size_t size) {
+  char line[64];
+  if (op == 'f') {
+    msnprintf(line, sizeof(line), "[HEAPTRACE] f %x\n", (uint32_t)ptr);
+  } else if (op == 'r') {
+    msnprintf(line, sizeof(line), "[HEAPTRACE] r %x %x %u\n",
+              (uint32_t)ptr, (uint32_t)new_ptr, (uint32_t)size);
+  } else {
+    msnprintf(line, sizeof(line), "[HEAPTRACE] a %x %u\n", (uint32_t)ptr, (uint32_t)size);
+  }
+  debugf(line);
+}
+#else
+#define heap_trace(op, ptr, new_ptr, size)
+#endif
+
+/**
+ * the heap lives in a reserved virtual range and is split in two:
+ * blocks grow up from the bottom with sbrk,
+ * whole pages for the slab allocator are taken from the top.
+ * the range is reserved with paging_reserve on first use,
+ * frames are faulted in when a page is first touched.
+ */
+static char *const kernel_heap = (char*)KERNEL_HEAP_START;
 static size_t heap_offset = 0;
+static size_t page_offset = HEAP_SIZE;
+static void *free_pages = NULL; // pages given back by the slab allocator
+static bool heap_reserved = false;
+static size_t fresh_offset = 0; // the break has never been above this, so what is above is still zero
+static size_t heap_limit = HEAP_SIZE; // most bytes the heap hands out, see heap_set_limit
 
+/**
+ * promise frames for pages about to be handed out
+ * @param size bytes about to be handed out
+ * @param pages pages among them that were never handed out before
+ * @return false if the range cannot be reserved, the heap is at its limit
+ *         or frames are running out, a fault on a page that cannot be backed
+ *         would panic instead
+ * @note large objects draw on the same frames, paging_commit counts both
+ */
+static bool heap_commit(size_t size, uint32_t pages) {
+  if (heap_offset + (HEAP_SIZE - page_offset) + size > heap_limit) {
+    return false;
+  }
+  if (!heap_reserved) {
+    heap_reserved = paging_reserve((uint32_t)KERNEL_HEAP_START, HEAP_SIZE,
+                                   PAGE_WRITABLE | paging_global_flag(), kernel_directory);
+    if (!heap_reserved) {
+      return false;
+    }
+  }
+  return !pages || paging_commit((uint32_t)KERNEL_HEAP_START, pages, kernel_directory);
+}
+
+/**
+ * blocks are kept in one list in address order,
+ * so next and prev are also the physical neighbours.
+ */
 struct block_meta {
   size_t size;
   struct block_meta *next;
-  int free;
+  struct block_meta *prev;
+  uint16_t free;
+  uint16_t tag;           // heap_tag of the owner
 };
 
 #define META_SIZE sizeof(struct block_meta)
+#define BLOCK_ALIGN(size) (((size) + 7) & ~(size_t)7)
+#define BLOCK_MIN_SPLIT 16 // smallest payload worth splitting off
 
 void *global_base = NULL;
 
+static heap_tag_stats tag_stats[HEAP_TAG_COUNT];
+
+struct heap_shrinker {
+  heap_shrinker_stats stats;
+  heap_shrinker_fn shrink;
+};
+
+static struct heap_shrinker shrinkers[HEAP_SHRINKER_MAX];
+static uint32_t shrinker_count = 0;
+static bool shrinking = false;
+static const char *const tag_names[HEAP_TAG_COUNT] = {
+  "kernel", "filesystem", "elf"
+};
+
 void *sbrk(int increment) {
     if (increment == 0) {
         return &kernel_heap[heap_offset];
     }
+
+    if (increment < 0 && (size_t)-increment > heap_offset) {
+        return (void*)-1; // can't shrink below the start
+    }
     
-    if (heap_offset + increment > sizeof(kernel_heap)) {
+    if (heap_offset + increment > page_offset) {
         return (void*)-1; // out of memory
     }
+
+    if (increment > 0) {
+        // pages up to the high-water mark were committed when the break first passed them
+        size_t new_end = PAGE_ALIGN_UP(heap_offset + increment);
+        size_t old_end = PAGE_ALIGN_UP(fresh_offset);
+        uint32_t pages = new_end > old_end ? (new_end - old_end) / PAGE_SIZE : 0;
+        if (!heap_commit(increment, pages)) {
+            return (void*)-1; // out of memory
+        }
+    }
     
     void *old_break = &kernel_heap[heap_offset];
     heap_offset += increment;
+    if (heap_offset > fresh_offset) {
+        fresh_offset = heap_offset;
+    }
     return old_break;
 }
 
+/**
+ * cap how much of the heap's range may be handed out
+ * @param limit bytes, clamped to the size of the range
+ */
+void heap_set_limit(size_t limit) {
+  heap_limit = limit < HEAP_SIZE ? limit : HEAP_SIZE;
+}
+
+/**
+ * take one page from the top of the heap
+ * @return page aligned pointer, or NULL if the heap is full
+ */
+void *heap_page_alloc(void) {
+  if (free_pages) {
+    void *page = free_pages;
+    free_pages = *(void**)page;
+    return page;
+  }
+
+  if (page_offset - heap_offset < PAGE_SIZE) {
+    return NULL; // would run into the blocks
+  }
+  // a page the break once passed was committed back then
+  bool fresh = page_offset - PAGE_SIZE >= PAGE_ALIGN_UP(fresh_offset);
+  if (!heap_commit(PAGE_SIZE, fresh ? 1 : 0)) {
+    return NULL;
+  }
+  page_offset -= PAGE_SIZE;
+  return &kernel_heap[page_offset];
+}
+
+/**
+ * give a page back to the heap
+ */
+void heap_page_free(void *page) {
+  *(void**)page = free_pages;
+  free_pages = page;
+}
+
+/**
+ * @return true if ptr points into the page area of the heap
+ */
+bool heap_is_page(void *ptr) {
+  return (char*)ptr >= &kernel_heap[page_offset] && (char*)ptr < &kernel_heap[HEAP_SIZE];
+}
+
 // sbrk some extra space every time we need it.
 void *nofree_malloc(size_t size) {
   void *p = sbrk(0);
@@ -57,34 +206,202 @@ struct block_meta *find_free_block(struct block_meta **last, size_t size) {
   return current;
 }
 
+/**
+ * @return true if nothing was sbrk'd after this block
+ */
+static bool block_at_top(struct block_meta *block) {
+  return (char*)(block + 1) + block->size == (char*)sbrk(0);
+}
+
 struct block_meta *request_space(struct block_meta* last, size_t size) {
   struct block_meta *block;
+
+  // a free block at the top of the heap only needs to grow by the difference
+  if (last && last->free && block_at_top(last)) {
+    if (sbrk(size - last->size) == (void*) -1) {
+      return NULL; // sbrk failed.
+    }
+    last->size = size;
+    last->free = 0;
+    return last;
+  }
+
   block = sbrk(0);
   void *request = sbrk(size + META_SIZE);
-  assert((void*)block == request); // check that sbrk returned what we expected
   if (request == (void*) -1) {
     return NULL; // sbrk failed.
   }
+  assert((void*)block == request); // check that sbrk returned what we expected
   
   if (last) { // NULL on first request.
     last->next = block;
   }
   block->size = size;
   block->next = NULL;
+  block->prev = last;
   block->free = 0;
   return block;
 }
 
+/**
+ * cut the tail off a block if it is big enough to be a block of its own
+ * @note the tail is left free, the caller must not need it
+ * @return true if the block was split
+ */
+static bool split_block(struct block_meta *block, size_t size) {
+  if (block->size < size + META_SIZE + BLOCK_MIN_SPLIT) {
+    return false; // remainder too small to be useful
+  }
+
+  struct block_meta *tail = (struct block_meta*)((char*)(block + 1) + size);
+  tail->size = block->size - size - META_SIZE;
+  tail->free = 1;
+  tail->prev = block;
+  tail->next = block->next;
+  if (tail->next) {
+    tail->next->prev = tail;
+  }
+  block->next = tail;
+  block->size = size;
+  return true;
+}
+
+/**
+ * merge a block with the block physically after it
+ */
+static void merge_with_next(struct block_meta *block) {
+  struct block_meta *next = block->next;
+  block->size += META_SIZE + next->size;
+  block->next = next->next;
+  if (block->next) {
+    block->next->prev = block;
+  }
+}
+
+/**
+ * the last block is free, give its memory back to sbrk
+ */
+static void trim_top(struct block_meta *block) {
+  if (block->prev) {
+    block->prev->next = NULL;
+  } else {
+    global_base = NULL;
+  }
+  sbrk(-(int)(block->size + META_SIZE));
+}
+
+void heap_tag_alloc(heap_tag tag, size_t size) {
+  heap_tag_stats *stats = &tag_stats[tag];
+  stats->live_bytes += size;
+  if (stats->live_bytes > stats->peak_bytes) {
+    stats->peak_bytes = stats->live_bytes;
+  }
+  stats->allocations++;
+}
+
+void heap_tag_free(heap_tag tag, size_t size) {
+  tag_stats[tag].live_bytes -= size;
+}
+
+/**
+ * account an allocation that was resized in place
+ */
+static void heap_tag_resize(heap_tag tag, size_t old_size, size_t new_size) {
+  heap_tag_stats *stats = &tag_stats[tag];
+  stats->live_bytes += new_size - old_size;
+  if (stats->live_bytes > stats->peak_bytes) {
+    stats->peak_bytes = stats->live_bytes;
+  }
+}
+
+void heap_tag_fail(heap_tag tag) {
+  tag_stats[tag].failures++;
+}
+
+/**
+ * get the accounting for one tag
+ */
+void heap_get_tag_stats(heap_tag tag, heap_tag_stats *stats) {
+  *stats = tag_stats[tag];
+  stats->name = tag_names[tag];
+}
+
+/**
+ * register a shrinker, called in order of registration when an allocation would fail
+ * @param name shown in the statistics
+ * @param shrink frees cached memory, gets the bytes wanted and returns the bytes freed
+ * @return false if there is no room for another shrinker
+ */
+bool heap_register_shrinker(const char *name, heap_shrinker_fn shrink) {
+  if (shrinker_count == HEAP_SHRINKER_MAX) {
+    return false;
+  }
+  shrinkers[shrinker_count].shrink = shrink;
+  shrinkers[shrinker_count].stats.name = name;
+  shrinkers[shrinker_count].stats.calls = 0;
+  shrinkers[shrinker_count].stats.reclaimed_bytes = 0;
+  shrinker_count++;
+  return true;
+}
+
+uint32_t heap_shrinker_count(void) {
+  return shrinker_count;
+}
+
+void heap_get_shrinker_stats(uint32_t index, heap_shrinker_stats *stats) {
+  *stats = shrinkers[index].stats;
+}
+
+/**
+ * ask the shrinkers for memory until they have freed enough
+ * @return bytes freed
+ */
+static size_t heap_shrink(size_t wanted) {
+  if (shrinking) {
+    return 0; // a shrinker that allocates must not end up in here again
+  }
+  shrinking = true;
+
+  size_t reclaimed = 0;
+  for (uint32_t i = 0; i < shrinker_count && reclaimed < wanted; i++) {
+    size_t freed = shrinkers[i].shrink(wanted - reclaimed);
+    shrinkers[i].stats.calls++;
+    shrinkers[i].stats.reclaimed_bytes += freed;
+    reclaimed += freed;
+  }
+
+  shrinking = false;
+  return reclaimed;
+}
+
 // if it's the first ever call, i.e., global_base == NULL, request_space and set global_base.
 // otherwise, if we can find a free block, use it.
 // if not, request_space.
-void *kmalloc(size_t size) {
+static void *heap_alloc_once(size_t size, heap_tag tag) {
   struct block_meta *block;
 
-  if (size <= 0) {
-    return NULL;
+  // big requests get whole pages of their own
+  if (size > LARGE_MIN_SIZE) {
+    void *ptr = large_alloc(size, tag);
+    if (ptr) {
+      heap_tag_alloc(tag, large_object_size(ptr));
+      return ptr;
+    }
+    // out of frames or virtual space, fall through to the block list
+  }
+
+  // small requests come from the size class slabs
+  if (size <= SLAB_MAX_SIZE) {
+    void *ptr = slab_alloc(size, tag);
+    if (ptr) {
+      heap_tag_alloc(tag, slab_object_size(ptr));
+      return ptr;
+    }
+    // out of slab pages, fall through to the block list
   }
 
+  size = BLOCK_ALIGN(size);
+
   if (!global_base) { // first call.
     block = request_space(NULL, size);
     if (!block) {
@@ -100,20 +417,125 @@ void *kmalloc(size_t size) {
 	return NULL;
       }
     } else {      // found free block
+      split_block(block, size);
       block->free = 0;
     }
   }
-  
+
+  block->tag = tag;
+  heap_tag_alloc(tag, block->size);
   return(block+1);
 }
 
+static void *heap_alloc(size_t size, heap_tag tag) {
+  if (size <= 0) {
+    return NULL;
+  }
+  if (tag >= HEAP_TAG_COUNT) {
+    tag = HEAP_TAG_KERNEL;
+  }
+
+  void *ptr = heap_alloc_once(size, tag);
+  if (!ptr && heap_shrink(size)) {
+    // caches gave some memory back, try once more before failing
+    ptr = heap_alloc_once(size, tag);
+  }
+  if (!ptr) {
+    heap_tag_fail(tag);
+  }
+  return ptr;
+}
+
+void *kmalloc(size_t size) {
+  return kmalloc_tagged(size, HEAP_TAG_KERNEL);
+}
+
+void *kmalloc_tagged(size_t size, heap_tag tag) {
+  void *ptr = heap_alloc(size, tag);
+  if (ptr) {
+    heap_trace('a', ptr, NULL, size);
+  }
+  return ptr;
+}
+
 void *kcalloc(size_t nelem, size_t elsize) {
   size_t size = nelem * elsize;
+  if (elsize && size / elsize != nelem) {
+    return NULL; // overflow
+  }
+  size_t fresh = fresh_offset;
   void *ptr = kmalloc(size);
-  memset(ptr, 0, size);
+  if (!ptr) {
+    return NULL;
+  }
+
+  // large objects always start out on fresh demand-zero pages
+  if (large_owns(ptr)) {
+    return ptr;
+  }
+
+  // memory the break never reached comes from demand-zero pages, skip clearing it
+  char *start = ptr;
+  char *end = start + size;
+  if (start >= kernel_heap && start < &kernel_heap[heap_offset] && end > &kernel_heap[fresh]) {
+    end = start > &kernel_heap[fresh] ? start : &kernel_heap[fresh];
+  }
+  memset(start, 0, end - start);
   return ptr;
 }
 
+/**
+ * merge a free block with its free neighbours straight away,
+ * and give it back to sbrk if it ends up at the top of the heap
+ */
+static void coalesce(struct block_meta *block) {
+  if (block->next && block->next->free) {
+    merge_with_next(block);
+  }
+  if (block->prev && block->prev->free) {
+    block = block->prev;
+    merge_with_next(block);
+  }
+
+  if (!block->next && block_at_top(block)) {
+    trim_top(block);
+  }
+}
+
+/**
+ * resize a block without moving it
+ * @param size new payload size, already aligned
+ * @return true if the block now holds size bytes
+ */
+static bool resize_block(struct block_meta *block, size_t size) {
+  if (size <= block->size) {
+    // shrink, the tail goes back to the free space
+    if (split_block(block, size)) {
+      coalesce(block->next);
+    }
+    return true;
+  }
+
+  // grow into a free neighbour
+  struct block_meta *next = block->next;
+  if (next && next->free && block->size + META_SIZE + next->size >= size) {
+    merge_with_next(block);
+    split_block(block, size);
+    return true;
+  }
+
+  // grow into the unused space above the heap top
+  if (!next && block_at_top(block)) {
+    if (sbrk(size - block->size) == (void*) -1) {
+      return false;
+    }
+    block->size = size;
+    return true;
+  }
+
+  return false;
+}
+
 /**
  * @todo add validation for ptr
  */
@@ -121,14 +543,61 @@ struct block_meta *get_block_ptr(void *ptr) {
   return (struct block_meta*)ptr - 1;
 }
 
-void kfree(void *ptr) {
-  if (!ptr) {
+static void heap_free(void *ptr) {
+  if (large_owns(ptr)) {
+    heap_tag_free(large_object_tag(ptr), large_object_size(ptr));
+    large_free(ptr);
+    return;
+  }
+  if (heap_is_page(ptr)) {
+    heap_tag_free(slab_object_tag(ptr), slab_object_size(ptr));
+    slab_free(ptr);
     return;
   }
 
   struct block_meta* block_ptr = get_block_ptr(ptr);
   assert(block_ptr->free == 0);
+  heap_tag_free(block_ptr->tag, block_ptr->size);
   block_ptr->free = 1;
+  coalesce(block_ptr);
+}
+
+void kfree(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  heap_trace('f', ptr, NULL, 0);
+  heap_free(ptr);
+}
+
+/**
+ * collect fragmentation statistics for the heap
+ * @param stats filled with free space totals
+ */
+void heap_get_stats(heap_stats *stats) {
+  stats->heap_size = (paging_reserved_pages((uint32_t)KERNEL_HEAP_START, kernel_directory)
+                      + paging_reserved_pages((uint32_t)KERNEL_LARGE_START, kernel_directory)) * PAGE_SIZE;
+  stats->free_blocks = 0;
+
+  // the gap between the break and the page area is one free extent
+  size_t gap = page_offset - heap_offset;
+  stats->total_free = gap;
+  stats->largest_free = gap;
+
+  for (struct block_meta *block = global_base; block; block = block->next) {
+    if (block->free) {
+      stats->free_blocks++;
+      stats->total_free += block->size;
+      if (block->size > stats->largest_free) {
+        stats->largest_free = block->size;
+      }
+    }
+  }
+
+  // spare pages can be reused by the slabs, but are not contiguous
+  for (void *page = free_pages; page; page = *(void**)page) {
+    stats->total_free += PAGE_SIZE;
+  }
 }
 
 void *krealloc(void *ptr, size_t size) {
@@ -136,21 +605,53 @@ void *krealloc(void *ptr, size_t size) {
     // NULL ptr. realloc should act like malloc.
     return kmalloc(size);
   }
-
-  struct block_meta* block_ptr = get_block_ptr(ptr);
-  if (block_ptr->size >= size) {
+  if (size == 0) {
+    // nothing to resize to, the object stays as it is whichever allocator owns it
+    heap_trace('r', ptr, ptr, size);
     return ptr;
   }
 
+  size_t old_size;
+  heap_tag tag;
+  if (large_owns(ptr)) {
+    // large objects grow and shrink a page at a time while they stay large
+    old_size = large_object_size(ptr);
+    tag = large_object_tag(ptr);
+    if (size > LARGE_MIN_SIZE && large_resize(ptr, size)) {
+      heap_tag_resize(tag, old_size, large_object_size(ptr));
+      heap_trace('r', ptr, ptr, size);
+      return ptr;
+    }
+  } else if (heap_is_page(ptr)) {
+    // slab objects stay put while the request still fits their class
+    old_size = slab_object_size(ptr);
+    tag = slab_object_tag(ptr);
+    if (old_size >= size) {
+      heap_trace('r', ptr, ptr, size);
+      return ptr;
+    }
+  } else {
+    struct block_meta *block = get_block_ptr(ptr);
+    old_size = block->size;
+    tag = block->tag;
+    if (resize_block(block, BLOCK_ALIGN(size))) {
+      heap_tag_resize(tag, old_size, block->size);
+      heap_trace('r', ptr, ptr, size);
+      return ptr;
+    }
+  }
+
+  // the new memory stays with the same owner
   void *new_ptr;
-  new_ptr = kmalloc(size);
+  new_ptr = heap_alloc(size, tag);
   if (!new_ptr) {
     /**
      * @todo set errno 
      */
     return NULL;
   }
-  memcpy(new_ptr, ptr, block_ptr->size);
-  kfree(ptr);  
+  memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+  heap_free(ptr);
+  heap_trace('r', ptr, new_ptr, size);
   return new_ptr;
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+/*
+    MooseOS Large object allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Objects bigger than LARGE_MIN_SIZE get a run of whole pages in a
+    reserved virtual range of their own, so they never fragment the
+    block list or the slabs. Pages are faulted in on first touch and
+    their frames go straight back to the frame allocator on free,
+    which also means a new run always starts out zeroed.
+*/
+
+#include "large/large.h"
+#include "paging/paging.h"
+#include "print/debug.h"
+
+#define LARGE_PAGES     (KERNEL_LARGE_SIZE / PAGE_SIZE)
+#define LARGE_MAGIC     0x1A46E0B7
+
+// header at the start of every run, the object follows it
+struct large_header {
+    uint32_t magic;
+    uint32_t pages;             // pages in the run
+    uint16_t tag;               // heap_tag of the owner
+    uint16_t reserved;
+    uint32_t padding;           // keeps the object 16 byte aligned
+};
+
+static char *const large_base = (char*)KERNEL_LARGE_START;
+static uint32_t page_bitmap[LARGE_PAGES / 32]; // 1 = page belongs to a run
+static uint32_t first_free = 0;                 // no free page below this one
+static bool large_reserved = false;
+static large_stats stats;
+
+static inline bool page_used(uint32_t index) {
+    return page_bitmap[index / 32] & (1u << (index % 32));
+}
+
+static void mark_pages(uint32_t index, uint32_t count, bool used) {
+    for (uint32_t i = index; i < index + count; i++) {
+        if (used) page_bitmap[i / 32] |= (1u << (i % 32));
+        else page_bitmap[i / 32] &= ~(1u << (i % 32));
+    }
+}
+
+/**
+ * first fit search for free pages
+ * @return index of the first page, LARGE_PAGES if no run is long enough
+ */
+static uint32_t find_run(uint32_t count) {
+    uint32_t start = first_free;
+    uint32_t length = 0;
+    uint32_t index = first_free;
+    while (index < LARGE_PAGES) {
+        if (!(index % 32) && page_bitmap[index / 32] == 0xFFFFFFFF) {
+            // skip full words
+            index += 32;
+            start = index;
+            length = 0;
+            continue;
+        }
+        if (page_used(index)) {
+            start = index + 1;
+            length = 0;
+        } else if (++length == count) {
+            return start;
+        }
+        index++;
+    }
+    return LARGE_PAGES;
+}
+
+static inline uint32_t pages_for(size_t size) {
+    return (size + sizeof(struct large_header) + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+/**
+ * @return header of a large object, NULL if ptr is not one
+ */
+static struct large_header *get_header(void *ptr) {
+    if (!large_owns(ptr)) {
+        return NULL;
+    }
+    struct large_header *header = (struct large_header*)ptr - 1;
+    if (header->magic != LARGE_MAGIC || (uintptr_t)header % PAGE_SIZE) {
+        debugf("[LARGE] Invalid pointer\n");
+        return NULL;
+    }
+    return header;
+}
+
+static inline uint32_t page_index(struct large_header *header) {
+    return (uint32_t)(((char*)header - large_base) / PAGE_SIZE);
+}
+
+static void count_pages(int32_t pages) {
+    stats.pages += pages;
+    if (stats.pages > stats.peak_pages) {
+        stats.peak_pages = stats.pages;
+    }
+}
+
+/**
+ * allocate a large object
+ * @return pointer to at least size bytes, NULL if out of memory
+ */
+void *large_alloc(size_t size, heap_tag tag) {
+    if (!large_reserved) {
+        large_reserved = paging_reserve((uint32_t)KERNEL_LARGE_START, KERNEL_LARGE_SIZE,
+                                        PAGE_WRITABLE | paging_global_flag(), kernel_directory);
+        if (!large_reserved) {
+            return NULL;
+        }
+    }
+
+    uint32_t pages = pages_for(size);
+    if (pages > LARGE_PAGES) {
+        return NULL;
+    }
+    uint32_t index = find_run(pages);
+    if (index == LARGE_PAGES) {
+        debugf("[LARGE] Out of virtual space\n");
+        return NULL;
+    }
+    // a fault on a page that cannot be backed would panic, promise the frames now
+    if (!paging_commit((uint32_t)(uintptr_t)(large_base + index * PAGE_SIZE), pages, kernel_directory)) {
+        return NULL;
+    }
+    mark_pages(index, pages, true);
+    if (index == first_free) {
+        first_free = index + pages;
+    }
+
+    struct large_header *header = (struct large_header*)(large_base + index * PAGE_SIZE);
+    header->magic = LARGE_MAGIC;
+    header->pages = pages;
+    header->tag = tag;
+
+    stats.objects++;
+    count_pages(pages);
+    return header + 1;
+}
+
+/**
+ * free a large object, its frames go back to the frame allocator
+ */
+void large_free(void *ptr) {
+    struct large_header *header = get_header(ptr);
+    if (!header) {
+        return;
+    }
+
+    uint32_t index = page_index(header);
+    uint32_t pages = header->pages;
+    header->magic = 0;
+    mark_pages(index, pages, false);
+    if (index < first_free) {
+        first_free = index;
+    }
+    paging_discard((uint32_t)(uintptr_t)header, pages * PAGE_SIZE, kernel_directory);
+
+    stats.objects--;
+    count_pages(-(int32_t)pages);
+}
+
+/**
+ * resize a large object without moving it
+ * @return true if the object now holds size bytes
+ */
+bool large_resize(void *ptr, size_t size) {
+    struct large_header *header = get_header(ptr);
+    if (!header) {
+        return false;
+    }
+
+    uint32_t index = page_index(header);
+    uint32_t pages = pages_for(size);
+    if (pages <= header->pages) {
+        // shrink, the tail pages go back
+        uint32_t spare = header->pages - pages;
+        if (spare) {
+            mark_pages(index + pages, spare, false);
+            if (index + pages < first_free) {
+                first_free = index + pages;
+            }
+            paging_discard((uint32_t)(uintptr_t)header + pages * PAGE_SIZE, spare * PAGE_SIZE, kernel_directory);
+            header->pages = pages;
+            count_pages(-(int32_t)spare);
+        }
+        return true;
+    }
+
+    // grow into the pages right after the run
+    uint32_t extra = pages - header->pages;
+    if (index + pages > LARGE_PAGES) {
+        return false;
+    }
+    for (uint32_t i = index + header->pages; i < index + pages; i++) {
+        if (page_used(i)) {
+            return false;
+        }
+    }
+    if (!paging_commit((uint32_t)(uintptr_t)header + header->pages * PAGE_SIZE, extra, kernel_directory)) {
+        return false;
+    }
+    mark_pages(index + header->pages, extra, true);
+    header->pages = pages;
+    count_pages(extra);
+    return true;
+}
+
+/**
+ * @return true if ptr points into the large object range
+ */
+bool large_owns(void *ptr) {
+    return (char*)ptr >= large_base && (char*)ptr < large_base + KERNEL_LARGE_SIZE;
+}
+
+/**
+ * @return usable bytes of a large object
+ */
+size_t large_object_size(void *ptr) {
+    struct large_header *header = get_header(ptr);
+    return header ? header->pages * PAGE_SIZE - sizeof(struct large_header) : 0;
+}
+
+heap_tag large_object_tag(void *ptr) {
+    struct large_header *header = get_header(ptr);
+    return header ? (heap_tag)header->tag : HEAP_TAG_KERNEL;
+}
+
+void large_get_stats(large_stats *out) {
+    *out = stats;
+}
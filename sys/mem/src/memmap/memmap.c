@@ -0,0 +1,72 @@
+/*
+    MooseOS Physical memory map
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Usable RAM as reported by the bootloader.
+    It is filled in before paging_init, which hands the regions
+    to the frame allocator.
+*/
+
+#include "memmap/memmap.h"
+#include "print/debug.h"
+
+static memmap_region regions[MEMMAP_MAX_REGIONS];
+static uint32_t region_count = 0;
+
+/**
+ * record a range of usable RAM
+ * @param start first byte of the range
+ * @param end first byte after the range
+ */
+void memmap_add_usable(uint32_t start, uint32_t end) {
+    if (end <= start) {
+        return;
+    }
+    if (region_count == MEMMAP_MAX_REGIONS) {
+        debugf("[MEMMAP] Too many memory regions, ignoring the rest\n");
+        return;
+    }
+    regions[region_count].start = start;
+    regions[region_count].end = end;
+    region_count++;
+}
+
+/**
+ * @param count set to the number of regions
+ * @return the usable regions, in the order the bootloader listed them
+ */
+const memmap_region *memmap_regions(uint32_t *count) {
+    *count = region_count;
+    return regions;
+}
+
+/**
+ * @return end of the highest usable region, MEMMAP_DEFAULT_END if there is no map
+ */
+uint32_t memmap_end(void) {
+    if (!region_count) {
+        return MEMMAP_DEFAULT_END;
+    }
+    uint32_t end = 0;
+    for (uint32_t i = 0; i < region_count; i++) {
+        if (regions[i].end > end) {
+            end = regions[i].end;
+        }
+    }
+    return end;
+}
+
+/**
+ * @return total usable RAM in bytes, MEMMAP_DEFAULT_END if there is no map
+ */
+uint32_t memmap_usable_bytes(void) {
+    if (!region_count) {
+        return MEMMAP_DEFAULT_END;
+    }
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < region_count; i++) {
+        total += regions[i].end - regions[i].start;
+    }
+    return total;
+}
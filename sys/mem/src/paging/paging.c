@@ -8,8 +8,26 @@
 */
 
 #include "paging/paging.h"
+#include "frame/frame.h"
+#include "memmap/memmap.h"
+#include "zeropool/zeropool.h"
+#include "cpuid/cpuid.h"
+#include "tsc/tsc.h"
+#include "string/string.h"
+#include "stdio/stdio.h"
 #include "print/debug.h"
 
+// CPUID leaf 1 EDX feature bits
+#define CPUID_EDX_PSE   (1 << 3)
+#define CPUID_EDX_PGE   (1 << 13)
+
+// CR4 bits
+#define CR4_PSE         (1 << 4)
+#define CR4_PGE         (1 << 7)
+
+// end of the kernel image, from the linker script
+extern char kernel_end[];
+
 // page directory and first page table
 uint32_t page_directory[1024] __attribute__((aligned(4096)));
 uint32_t first_page_table[1024] __attribute__((aligned(4096)));
@@ -17,9 +35,36 @@ uint32_t first_page_table[1024] __attribute__((aligned(4096)));
 page_directory_t *kernel_directory = (page_directory_t*)page_directory;
 page_directory_t *current_directory = (page_directory_t*)page_directory;
 
-// frame variables
-static uint32_t next_frame = 0x00500000;
-static uint32_t frames_allocated = 0;
+// end of usable physical memory
+static uint32_t memory_end = 0;
+
+// a virtual range that gets zeroed frames on first touch
+typedef struct {
+    uint32_t start;
+    uint32_t end;               // 0 if the slot is unused
+    uint32_t flags;
+    uint32_t pages;             // frames faulted in so far
+    uint32_t committed;         // pages handed out but not touched yet, see paging_commit
+    page_directory_t *dir;
+} reserved_region;
+
+static reserved_region reserved_regions[MAX_RESERVED_REGIONS];
+static uint32_t committed_pages = 0; // sum of every region's committed pages
+static page_fault_stats fault_stats;
+
+// copy-on-write breaks per address space
+typedef struct {
+    page_directory_t *dir;      // NULL if the slot is unused
+    uint32_t cow_breaks;
+} address_space_count;
+
+static address_space_count cow_counts[MAX_ADDRESS_SPACES];
+
+static reserved_region *find_region(uint32_t virtual_addr, page_directory_t *dir);
+static uint32_t *find_page_entry(uint32_t virtual_addr, page_directory_t *dir);
+
+// PAGE_GLOBAL once CR4.PGE is on, 0 before that or if the CPU lacks it
+static uint32_t global_flag = 0;
 
 // assembly functions for CR3 register manipulation
 void load_page_directory(uint32_t* page_dir) {
@@ -30,6 +75,7 @@ void enable_paging_asm(void) {
     uint32_t cr0;
     asm volatile("mov %%cr0, %0" : "=r"(cr0));
     cr0 |= 0x80000000; // Set PG bit (bit 31)
+    cr0 |= 0x00010000; // Set WP bit (bit 16) so kernel writes to copy-on-write pages fault too
     asm volatile("mov %0, %%cr0" : : "r"(cr0));
 }
 
@@ -40,35 +86,141 @@ void disable_paging_asm(void) {
     asm volatile("mov %0, %%cr0" : : "r"(cr0));
 }
 
+static uint32_t read_cr4(void) {
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+static void write_cr4(uint32_t cr4) {
+    asm volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+/**
+ * @return CPUID leaf 1 EDX feature flags, 0 if the leaf does not exist
+ */
+static uint32_t cpu_features(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    if (eax < 1) {
+        return 0;
+    }
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    return edx;
+}
+
 // TLB management functions
 void flush_tlb(void) {
+    if (global_flag) {
+        // toggling PGE is the only way to drop global entries as well
+        uint32_t cr4 = read_cr4();
+        write_cr4(cr4 & ~CR4_PGE);
+        write_cr4(cr4);
+        return;
+    }
     asm volatile("mov %%cr3, %%eax; mov %%eax, %%cr3" : : : "eax");
 }
 
+/**
+ * @return PAGE_GLOBAL if kernel mappings can be global, 0 otherwise
+ */
+uint32_t paging_global_flag(void) {
+    return global_flag;
+}
+
 void flush_tlb_entry(uint32_t virtual_addr) {
     asm volatile("invlpg (%0)" : : "r"(virtual_addr) : "memory");
 }
 
 void paging_init(uint32_t memory_size) {
+    // physical memory must stay below the user space
+    if (memory_size > USER_START) {
+        memory_size = USER_START;
+    }
+    memory_end = PAGE_ALIGN_DOWN(memory_size);
+
+    // usable RAM after the kernel image is free for the frame allocator
+    uint32_t frames_start = PAGE_ALIGN_UP((uint32_t)kernel_end);
+    if (frames_start < KERNEL_START) {
+        frames_start = KERNEL_START;
+    }
+    uint32_t region_count;
+    const memmap_region *regions = memmap_regions(&region_count);
+    for (uint32_t i = 0; i < region_count; i++) {
+        uint32_t start = regions[i].start > frames_start ? regions[i].start : frames_start;
+        uint32_t end = regions[i].end < memory_end ? regions[i].end : memory_end;
+        if (start < end) {
+            frame_add_region(start, end);
+        }
+    }
+    if (!region_count) {
+        frame_add_region(frames_start, memory_end); // no map, trust memory_size
+    }
+
+    uint32_t features = cpu_features();
+    bool use_pse = features & CPUID_EDX_PSE;
+    bool use_pge = features & CPUID_EDX_PGE;
+    uint32_t kernel_flags = PAGE_PRESENT | PAGE_WRITABLE | (use_pge ? PAGE_GLOBAL : 0);
+
     // create a blank page directory
     for (int i = 0; i < 1024; i++) {
         page_directory[i] = 0x00000002;
     }
 
-    // create first page table
-    for (unsigned int i = 0; i < 1024; i++) {
-        // attributes: supervisor level, read/write, present.
-        first_page_table[i] = (i * 0x1000) | 3;
+    /**
+     * identity map physical memory so the kernel can reach
+     * every frame it hands out (page tables, page directories).
+     * paging is still off here, so the new tables can be written directly.
+     */
+    uint32_t identity_tables = (memory_end + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE;
+    if (use_pse) {
+        // one 4MB page per directory entry, no page tables at all
+        write_cr4(read_cr4() | CR4_PSE);
+        for (uint32_t table = 0; table < identity_tables; table++) {
+            page_directory[table] = (table * LARGE_PAGE_SIZE) | PAGE_LARGE | kernel_flags;
+        }
+    } else {
+        // create first page table
+        for (unsigned int i = 0; i < 1024; i++) {
+            // attributes: supervisor level, read/write, present.
+            first_page_table[i] = (i * 0x1000) | kernel_flags;
+        }
+
+        // attributes: supervisor level, read/write, present
+        page_directory[0] = ((unsigned int)first_page_table) | 3;
+
+        for (uint32_t table = 1; table < identity_tables; table++) {
+            uint32_t *identity_table = (uint32_t*)kmalloc_aligned(sizeof(page_table_t));
+            if (!identity_table) {
+                break;
+            }
+            for (unsigned int i = 0; i < 1024; i++) {
+                identity_table[i] = MAKE_PHYS_ADDR(table, i) | kernel_flags;
+            }
+            page_directory[table] = ((unsigned int)identity_table) | 3;
+        }
     }
     
-    // attributes: supervisor level, read/write, present
-    page_directory[0] = ((unsigned int)first_page_table) | 3;
-    
     // load page directory into CR3
     load_page_directory(page_directory);
 
     // enable paging by setting the paging bit in CR0
     enable_paging_asm();
+
+    // global mappings only take effect once PGE is set, after paging is on
+    if (use_pge) {
+        write_cr4(read_cr4() | CR4_PGE);
+        global_flag = PAGE_GLOBAL;
+    }
+
+    char line[64];
+    msnprintf(line, sizeof(line), "[PAGING] %u frames free of %u MB mapped\n",
+              frame_free_count(), memory_end >> 20);
+    debugf(line);
+    debugf(use_pse ? "[PAGING] Kernel mapped with 4MB pages\n" : "[PAGING] Kernel mapped with 4KB pages\n");
+    if (use_pge) {
+        debugf("[PAGING] Global kernel pages enabled\n");
+    }
 }
 
 /**
@@ -86,26 +238,33 @@ void disable_paging(void) {
 
 void switch_page_directory(page_directory_t *dir) {
     current_directory = dir;
+    // reloading CR3 drops the old translations, global kernel ones stay
     load_page_directory((uint32_t*)dir);
-    flush_tlb();
+}
+
+/**
+ * @return true if the directory entry points at a page table owned by the kernel
+ */
+static bool is_kernel_table(int index, page_directory_t *dir) {
+    uint32_t entry = (*dir)[index];
+    return (entry & PAGE_PRESENT) && entry == (*kernel_directory)[index];
 }
 
 page_directory_t *create_page_directory(void) {
-    // allocate aligned memory for the new page directory
-    page_directory_t *new_dir = (page_directory_t*)kmalloc_aligned(sizeof(page_directory_t));
+    // a zeroed frame, every entry starts out not present
+    page_directory_t *new_dir = (page_directory_t*)zero_pool_alloc();
     if (!new_dir) {
         debugf("Failed to allocate memory for new page directory\n");
         return NULL;
     }
     
-    // initialize all entries as not present
+    // share the kernel mappings (identity map and heap) with the kernel directory
     for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
-        (*new_dir)[i] = 0x00000002; // supervisor, writable, not present
+        if ((*kernel_directory)[i] & PAGE_PRESENT) {
+            (*new_dir)[i] = (*kernel_directory)[i];
+        }
     }
     
-    // copy kernel mappings (first 4MB) from kernel directory
-    (*new_dir)[0] = (*kernel_directory)[0];
-    
     return new_dir;
 }
 
@@ -115,11 +274,31 @@ void destroy_page_directory(page_directory_t *dir) {
         return; // don't destroy kernel directory or NULL
     }
     
+    // forget the reserved ranges, their frames are dropped below
+    for (int i = 0; i < MAX_RESERVED_REGIONS; i++) {
+        if (reserved_regions[i].end && reserved_regions[i].dir == dir) {
+            committed_pages -= reserved_regions[i].committed;
+            reserved_regions[i].end = 0;
+        }
+    }
+    for (int i = 0; i < MAX_ADDRESS_SPACES; i++) {
+        if (cow_counts[i].dir == dir) {
+            cow_counts[i].dir = NULL;
+        }
+    }
+
     // free all page tables (except kernel ones)
-    for (int i = 1; i < PAGE_DIRECTORY_SIZE; i++) {
-        if ((*dir)[i] & PAGE_PRESENT) {
-            // free the page table
+    for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
+        if (((*dir)[i] & PAGE_PRESENT) && !is_kernel_table(i, dir)) {
+            // drop the frames this directory holds, shared ones survive
             page_table_t *table = (page_table_t*)((*dir)[i] & ~0xFFF);
+            for (int j = 0; j < PAGE_ENTRIES; j++) {
+                if (((*table)[j] & PAGE_PRESENT) && ((*table)[j] & PAGE_OWNED)) {
+                    frame_unref((*table)[j] & ~0xFFF);
+                }
+            }
+
+            // free the page table
             kfree_aligned(table);
         }
     }
@@ -128,7 +307,30 @@ void destroy_page_directory(page_directory_t *dir) {
     kfree_aligned(dir);
 }
 
-/** @note unused */
+/**
+ * start counting copy-on-write breaks for a directory
+ */
+static void track_address_space(page_directory_t *dir) {
+    address_space_count *slot = NULL;
+    for (int i = 0; i < MAX_ADDRESS_SPACES; i++) {
+        if (cow_counts[i].dir == dir) {
+            return;
+        }
+        if (!cow_counts[i].dir && !slot) {
+            slot = &cow_counts[i];
+        }
+    }
+    if (slot) {
+        slot->dir = dir;
+        slot->cow_breaks = 0;
+    }
+}
+
+/**
+ * @note unused
+ * @note frames owned by the user tables are shared copy-on-write,
+ *       other user mappings (devices, identity maps) are shared as they are
+ */
 page_directory_t *clone_page_directory(page_directory_t *src) {
     if (!src) {
         debugf("No page directory to clone\n");
@@ -145,7 +347,7 @@ page_directory_t *clone_page_directory(page_directory_t *src) {
     // copy all entries from source
     for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
         if ((*src)[i] & PAGE_PRESENT) {
-            if (i == 0) {
+            if (is_kernel_table(i, src)) {
                 // kernel space - share the same page table
                 (*new_dir)[i] = (*src)[i];
             } else {
@@ -158,9 +360,17 @@ page_directory_t *clone_page_directory(page_directory_t *src) {
                     return NULL;
                 }
                 
-                // copy all page entries
+                // share the frames, writable ones turn read-only in both copies
                 for (int j = 0; j < PAGE_ENTRIES; j++) {
-                    (*new_table)[j] = (*src_table)[j];
+                    uint32_t entry = (*src_table)[j];
+                    if ((entry & PAGE_PRESENT) && (entry & PAGE_OWNED)) {
+                        if (entry & PAGE_WRITABLE) {
+                            entry = (entry & ~PAGE_WRITABLE) | PAGE_COW;
+                            (*src_table)[j] = entry;
+                        }
+                        frame_ref(entry & ~0xFFF);
+                    }
+                    (*new_table)[j] = entry;
                 }
                 
                 // set directory entry with same flags
@@ -168,7 +378,23 @@ page_directory_t *clone_page_directory(page_directory_t *src) {
             }
         }
     }
-    
+
+    // the source lost write access to its shared pages
+    if (src == current_directory) {
+        flush_tlb();
+    }
+
+    // untouched parts of reserved ranges still fill in on demand in the copy
+    for (int i = 0; i < MAX_RESERVED_REGIONS; i++) {
+        reserved_region *region = &reserved_regions[i];
+        if (region->end && region->dir == src
+            && paging_reserve(region->start, region->end - region->start, region->flags, new_dir)) {
+            find_region(region->start, new_dir)->pages = region->pages;
+        }
+    }
+
+    track_address_space(src);
+    track_address_space(new_dir);
     return new_dir;
 }
 
@@ -180,6 +406,9 @@ page_table_t *get_page_table(uint32_t virtual_addr, page_directory_t *dir) {
         debugf("Page table for virtual address does not exist\n");
         return NULL;
     }
+    if (pd[table_index] & PAGE_LARGE) { // 4MB page, there is no table
+        return NULL;
+    }
     
     return (page_table_t*)(pd[table_index] & ~0xFFF);
 }
@@ -190,6 +419,10 @@ page_table_t *create_page_table(uint32_t virtual_addr, page_directory_t *dir) {
     
     // check if page table already exists
     if (pd[table_index] & PAGE_PRESENT) {
+        if (pd[table_index] & PAGE_LARGE) {
+            debugf("Address is covered by a 4MB page\n");
+            return NULL;
+        }
         return (page_table_t*)(pd[table_index] & ~0xFFF);
     }
     
@@ -198,17 +431,12 @@ page_table_t *create_page_table(uint32_t virtual_addr, page_directory_t *dir) {
         return (page_table_t*)first_page_table;
     }
     
-    // allocate new page table for user space
-    page_table_t *new_table = (page_table_t*)kmalloc_aligned(sizeof(page_table_t));
+    // allocate new page table for user space, zeroed so every entry is not present
+    page_table_t *new_table = (page_table_t*)zero_pool_alloc();
     if (!new_table) {
         return NULL;
     }
     
-    // initialize all entries as not present
-    for (int i = 0; i < PAGE_ENTRIES; i++) {
-        (*new_table)[i] = 0x00000002; // supervisor, writable, not present
-    }
-    
     // add page table to directory
     pd[table_index] = ((uint32_t)new_table) | PAGE_PRESENT | PAGE_WRITABLE;
     
@@ -236,6 +464,57 @@ bool map_page(uint32_t virtual_addr, uint32_t physical_addr, uint32_t flags, pag
     return true; // success
 }
 
+/**
+ * @return true if [start, end) meets a reserved range, or the heap windows
+ *         that are only reserved on first use
+ */
+static bool overlaps_reserved(uint64_t start, uint64_t end) {
+    if (start < (uint64_t)KERNEL_HEAP_START + KERNEL_HEAP_SIZE && KERNEL_HEAP_START < end) {
+        return true;
+    }
+    if (start < (uint64_t)KERNEL_LARGE_START + KERNEL_LARGE_SIZE && KERNEL_LARGE_START < end) {
+        return true;
+    }
+    for (int i = 0; i < MAX_RESERVED_REGIONS; i++) {
+        reserved_region *region = &reserved_regions[i];
+        if (region->end && start < region->end && region->start < end) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * make physical memory outside RAM (firmware tables, device registers)
+ * reachable at the same address in the kernel directory
+ * @param flags extra page flags, e.g. PAGE_NO_CACHE for registers
+ * @return false if a page table could not be made or the range lies where
+ *         reserved ranges fault their frames in, callers fall back then
+ * @note call before other directories are created, they copy the kernel entries
+ */
+bool paging_map_identity(uint32_t start, uint32_t size, uint32_t flags) {
+    uint32_t end = PAGE_ALIGN_UP(start + size);
+    // reserved ranges are page aligned, so the bytes overlap if the pages do
+    if (overlaps_reserved(start, (uint64_t)start + size)) {
+        debugf("[PAGING] Identity range overlaps a reserved range\n");
+        return false;
+    }
+    for (uint32_t page = PAGE_ALIGN_DOWN(start); page != end; page += PAGE_SIZE) {
+        uint32_t dir_entry = (*kernel_directory)[GET_TABLE_INDEX(page)];
+        if ((dir_entry & PAGE_PRESENT) && (dir_entry & PAGE_LARGE)) {
+            continue; // inside the identity mapped RAM
+        }
+        uint32_t *entry = find_page_entry(page, kernel_directory);
+        if (entry && (*entry & PAGE_PRESENT)) {
+            continue;
+        }
+        if (!map_page(page, page, PAGE_PRESENT | PAGE_WRITABLE | global_flag | flags, kernel_directory)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /** @note unused */
 bool unmap_page(uint32_t virtual_addr, page_directory_t *dir) {
     page_table_t *table = get_page_table(virtual_addr, dir);
@@ -256,6 +535,11 @@ bool unmap_page(uint32_t virtual_addr, page_directory_t *dir) {
 
 /** @note unused */
 uint32_t get_physical_addr(uint32_t virtual_addr, page_directory_t *dir) {
+    uint32_t dir_entry = (*dir)[GET_TABLE_INDEX(virtual_addr)];
+    if ((dir_entry & PAGE_PRESENT) && (dir_entry & PAGE_LARGE)) {
+        return (dir_entry & ~(LARGE_PAGE_SIZE - 1)) | (virtual_addr & (LARGE_PAGE_SIZE - 1));
+    }
+
     page_table_t *table = get_page_table(virtual_addr, dir);
     if (!table) {
         return 0; // page table doesn't exist
@@ -272,27 +556,331 @@ uint32_t get_physical_addr(uint32_t virtual_addr, page_directory_t *dir) {
     return (page_entry & ~0xFFF) | page_offset;
 }
 
-/** frame allocator. @note unused */
+/**
+ * @return the page table entry for an address, NULL if there is no page table
+ * @note unlike get_page_table this stays quiet, missing tables are normal here
+ */
+static uint32_t *find_page_entry(uint32_t virtual_addr, page_directory_t *dir) {
+    uint32_t dir_entry = (*dir)[GET_TABLE_INDEX(virtual_addr)];
+    if (!(dir_entry & PAGE_PRESENT) || (dir_entry & PAGE_LARGE)) {
+        return NULL;
+    }
+    page_table_t *table = (page_table_t*)(dir_entry & ~0xFFF);
+    return &(*table)[GET_PAGE_INDEX(virtual_addr)];
+}
+
+/**
+ * @return the reserved range holding an address, NULL if there is none
+ * @note ranges of the kernel directory are visible from every directory
+ */
+static reserved_region *find_region(uint32_t virtual_addr, page_directory_t *dir) {
+    for (int i = 0; i < MAX_RESERVED_REGIONS; i++) {
+        reserved_region *region = &reserved_regions[i];
+        if (region->end && virtual_addr >= region->start && virtual_addr < region->end
+            && (region->dir == dir || region->dir == kernel_directory)) {
+            return region;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * reserve a range of virtual memory without backing it.
+ * nothing is mapped until the range is touched, then page_fault_handler
+ * maps a zeroed frame, so large reservations cost nothing up front.
+ * @param start page aligned start of the range
+ * @param size size of the range, rounded up to whole pages
+ * @param flags flags for the pages, PAGE_PRESENT is added on first touch
+ * @param dir directory to map into, kernel_directory ranges are shared
+ * @return true if the range was reserved
+ */
+bool paging_reserve(uint32_t start, uint32_t size, uint32_t flags, page_directory_t *dir) {
+    size = PAGE_ALIGN_UP(size);
+    uint32_t end = start + size;
+    if (!dir || !size || start % PAGE_SIZE || end <= start || start < memory_end) {
+        debugf("[PAGING] Invalid range to reserve\n");
+        return false;
+    }
+
+    reserved_region *slot = NULL;
+    for (int i = 0; i < MAX_RESERVED_REGIONS; i++) {
+        reserved_region *region = &reserved_regions[i];
+        if (!region->end) {
+            if (!slot) {
+                slot = region;
+            }
+            continue;
+        }
+        bool shared = region->dir == dir || region->dir == kernel_directory || dir == kernel_directory;
+        if (shared && start < region->end && region->start < end) {
+            debugf("[PAGING] Reserved range overlaps another one\n");
+            return false;
+        }
+    }
+    if (!slot) {
+        debugf("[PAGING] Too many reserved ranges\n");
+        return false;
+    }
+
+    slot->start = start;
+    slot->end = end;
+    slot->flags = (flags & 0xFFF) & ~PAGE_PRESENT;
+    slot->pages = 0;
+    slot->committed = 0;
+    slot->dir = dir;
+    return true;
+}
+
+/**
+ * promise frames for untouched pages of a reserved range before handing them out,
+ * so their first touch cannot run out of frames.
+ * the promise is kept until the page is touched or discarded.
+ * @param start address inside the range
+ * @param pages pages that will be touched later
+ * @return false if the free frames are already promised to other pages
+ */
+bool paging_commit(uint32_t start, uint32_t pages, page_directory_t *dir) {
+    reserved_region *region = find_region(start, dir);
+    if (!region) {
+        debugf("[PAGING] No reserved range to commit\n");
+        return false;
+    }
+    // keep one frame spare for a page table the first touch may need
+    if (frame_free_count() <= committed_pages + pages) {
+        return false;
+    }
+    region->committed += pages;
+    committed_pages += pages;
+    return true;
+}
+
+// a committed page got its frame, or is given back untouched
+static void uncommit(reserved_region *region, uint32_t pages) {
+    if (pages > region->committed) {
+        pages = region->committed;
+    }
+    region->committed -= pages;
+    committed_pages -= pages;
+}
+
+/**
+ * unmap the touched pages of part of a reserved range and drop their frames,
+ * the untouched ones give back their commitment
+ */
+static void discard_pages(reserved_region *region, uint32_t start, uint32_t end) {
+    bool flush = region->dir == current_directory || region->dir == kernel_directory;
+    uint32_t untouched = (end - start) / PAGE_SIZE;
+    uint32_t addr = start;
+    while (addr < end) {
+        uint32_t *entry = find_page_entry(addr, region->dir);
+        if (!entry) {
+            // nothing was touched under this table, skip to the next one
+            addr = (addr & ~(LARGE_PAGE_SIZE - 1)) + LARGE_PAGE_SIZE;
+            if (!addr) {
+                break; // wrapped past the top of memory
+            }
+            continue;
+        }
+        if ((*entry & PAGE_PRESENT) && (*entry & PAGE_OWNED)) {
+            frame_unref(*entry & ~0xFFF);
+            *entry = 0x00000002;
+            region->pages--;
+            untouched--;
+            if (flush) {
+                flush_tlb_entry(addr);
+            }
+        }
+        addr += PAGE_SIZE;
+    }
+    uncommit(region, untouched);
+}
+
+/**
+ * give up a reserved range, the frames that were touched are freed
+ * @param start start of the range as passed to paging_reserve
+ * @note the page tables stay in place, they are reused by later mappings
+ */
+void paging_release(uint32_t start, page_directory_t *dir) {
+    reserved_region *region = NULL;
+    for (int i = 0; i < MAX_RESERVED_REGIONS; i++) {
+        if (reserved_regions[i].end && reserved_regions[i].start == start && reserved_regions[i].dir == dir) {
+            region = &reserved_regions[i];
+            break;
+        }
+    }
+    if (!region) {
+        debugf("[PAGING] No reserved range to release\n");
+        return;
+    }
+
+    discard_pages(region, region->start, region->end);
+    region->end = 0;
+}
+
+/**
+ * give the frames behind part of a reserved range back, the range stays
+ * reserved and reads as zero again on the next touch
+ * @param start page aligned start of the part
+ * @param size bytes, rounded up to whole pages
+ */
+void paging_discard(uint32_t start, uint32_t size, page_directory_t *dir) {
+    reserved_region *region = find_region(start, dir);
+    uint32_t end = start + PAGE_ALIGN_UP(size);
+    if (!region || start % PAGE_SIZE || end > region->end || end < start) {
+        debugf("[PAGING] Invalid range to discard\n");
+        return;
+    }
+    discard_pages(region, start, end);
+}
+
+/**
+ * @return pages of all reserved ranges that are promised a frame but not touched yet
+ */
+uint32_t paging_committed_pages(void) {
+    return committed_pages;
+}
+
+/**
+ * @return number of frames backing a reserved range, 0 if it is not reserved
+ */
+uint32_t paging_reserved_pages(uint32_t start, page_directory_t *dir) {
+    for (int i = 0; i < MAX_RESERVED_REGIONS; i++) {
+        if (reserved_regions[i].end && reserved_regions[i].start == start && reserved_regions[i].dir == dir) {
+            return reserved_regions[i].pages;
+        }
+    }
+    return 0;
+}
+
+void paging_get_fault_stats(page_fault_stats *stats) {
+    *stats = fault_stats;
+}
+
+/**
+ * @return copy-on-write breaks in an address space since it was cloned
+ */
+uint32_t paging_cow_breaks(page_directory_t *dir) {
+    for (int i = 0; i < MAX_ADDRESS_SPACES; i++) {
+        if (cow_counts[i].dir == dir) {
+            return cow_counts[i].cow_breaks;
+        }
+    }
+    return 0;
+}
+
+/**
+ * give the current address space its own writable copy of a shared page
+ * @param entry page table entry of the faulting page
+ * @return false if there is no frame for the copy
+ */
+static bool break_cow(uint32_t *entry, uint32_t page) {
+    uint32_t frame = *entry & ~0xFFF;
+    uint32_t flags = ((*entry & 0xFFF) & ~PAGE_COW) | PAGE_WRITABLE;
+
+    // the last sharer keeps the frame
+    if (frame_ref_count(frame) > 1) {
+        uint32_t copy = alloc_frame();
+        if (!copy) {
+            debugf("[PAGING] Out of frames for a copy-on-write page\n");
+            return false;
+        }
+        // both frames are identity mapped
+        memcpy((void*)copy, (void*)frame, PAGE_SIZE);
+        frame_unref(frame);
+        frame = copy;
+    }
+
+    *entry = frame | flags;
+    flush_tlb_entry(page);
+
+    fault_stats.cow_breaks++;
+    for (int i = 0; i < MAX_ADDRESS_SPACES; i++) {
+        if (cow_counts[i].dir == current_directory) {
+            cow_counts[i].cow_breaks++;
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * serve a page fault (vector 14)
+ * @param error_code error code pushed by the CPU
+ * @param virtual_addr faulting address, from CR2
+ * @return true if the page is now mapped and the access can be retried,
+ *         false if the fault is a real error
+ */
+bool page_fault_handler(uint32_t error_code, uint32_t virtual_addr) {
+    uint64_t start = rdtsc();
+
+    uint32_t page = PAGE_ALIGN_DOWN(virtual_addr);
+
+    if (error_code & PAGE_FAULT_PRESENT) {
+        uint32_t *entry = find_page_entry(page, current_directory);
+        if ((error_code & PAGE_FAULT_WRITE) && entry && (*entry & PAGE_COW)
+            && break_cow(entry, page)) {
+            return true;
+        }
+        fault_stats.failed_faults++;
+        return false; // protection violation
+    }
+
+    reserved_region *region = find_region(page, current_directory);
+    if (!region) {
+        fault_stats.failed_faults++;
+        return false;
+    }
+
+    uint32_t *entry = find_page_entry(page, region->dir);
+    if (!entry || !(*entry & PAGE_PRESENT)) {
+        uint32_t frame = zero_pool_alloc();
+        if (!frame) {
+            debugf("[PAGING] Out of frames for a reserved page\n");
+            fault_stats.failed_faults++;
+            return false;
+        }
+
+        if (!map_page(page, frame, region->flags | PAGE_PRESENT | PAGE_OWNED, region->dir)) {
+            free_frame(frame);
+            fault_stats.failed_faults++;
+            return false;
+        }
+        region->pages++;
+        uncommit(region, 1);
+    }
+
+    // a kernel range whose page table is newer than this directory
+    uint32_t table_index = GET_TABLE_INDEX(page);
+    if (region->dir != current_directory && !((*current_directory)[table_index] & PAGE_PRESENT)) {
+        (*current_directory)[table_index] = (*region->dir)[table_index];
+    }
+
+    uint32_t cycles = (uint32_t)(rdtsc() - start);
+    fault_stats.minor_faults++;
+    fault_stats.total_cycles += cycles;
+    if (cycles > fault_stats.max_cycles) {
+        fault_stats.max_cycles = cycles;
+    }
+    return true;
+}
+
+/**
+ * frame allocator
+ * @return physical address of a free frame, or 0 if memory is exhausted
+ */
 uint32_t alloc_frame(void) {
-    uint32_t frame = next_frame;
-    next_frame += PAGE_SIZE;
-    frames_allocated++;
-    return frame;
+    return frame_alloc_order(0);
 }
 
-/** @note unused */
+/**
+ * give a frame back to the frame allocator
+ */
 void free_frame(uint32_t frame_addr) {
-    // just decrements counter
-    /** @todo Implement frame deallocation */
-    if (frames_allocated > 0) {
-        frames_allocated--;
-    }
+    frame_free_block(frame_addr);
 }
 
-/** @note unused */
 bool is_frame_allocated(uint32_t frame_addr) {
-    // check if frame is within allocated range
-    return (frame_addr >= 0x00500000 && frame_addr < next_frame);
+    return frame_is_allocated(frame_addr);
 }
 
 /** @note unused */
@@ -303,16 +891,12 @@ void identity_map_kernel(page_directory_t *dir) {
     }
 }
 
+/**
+ * allocate physically contiguous, page aligned memory
+ * @note the memory is identity mapped, so the pointer is also the physical address
+ */
 void *kmalloc_aligned(uint32_t size) {
-    // align size to page boundary
-    size = PAGE_ALIGN_UP(size);
-    
-    // allocate from frame allocator
-    uint32_t frame = next_frame;
-    next_frame += size;
-    frames_allocated++;
-    
-    return (void*)frame;
+    return (void*)frame_alloc_order(frame_order_for_size(size));
 }
 
 /** @note unused */
@@ -325,6 +909,8 @@ void *kmalloc_phys(uint32_t size, uint32_t *phys_addr) {
 }
 
 void kfree_aligned(void *ptr) {
-    // just decrease the counter for now
-    frames_allocated--;
+    if (!ptr) {
+        return;
+    }
+    frame_free_block((uint32_t)ptr);
 }
@@ -0,0 +1,370 @@
+/*
+    MooseOS Slab allocator
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Small allocations are served from power-of-two size classes.
+    Every class keeps a list of partially used pages, and every page
+    keeps its own list of free objects, so allocating and freeing
+    never walks the heap.
+
+    The size classes are plain object caches. Named caches for one
+    object type can also be created with a constructor, which runs
+    once per object when its page is carved, not on every allocation.
+
+    Objects of any owner share the size classes, so a kmalloc page
+    keeps a tag byte per object between its header and its objects.
+    A named cache has one owner, which the cache records.
+*/
+
+#include "slab/slab.h"
+#include "heap/heap.h"
+#include "paging/paging.h"
+#include "string/string.h"
+#include "print/debug.h"
+#include "assert/assert.h"
+
+// header at the start of every slab page
+struct slab_page {
+    uint32_t magic;
+    uint16_t in_use;            // objects handed out from this page
+    uint16_t reserved;
+    kmem_cache *cache;          // cache that owns this page
+    void *free_list;            // free objects inside this page
+    struct slab_page *next;     // partial list links
+    struct slab_page *prev;
+};
+
+struct kmem_cache {
+    const char *name;
+    size_t object_size;         // bytes between objects
+    size_t link_offset;         // where the free list link lives inside a free object
+    uint16_t objects_per_page;
+    uint16_t data_offset;       // objects start here, after the header and any tag bytes
+    bool object_tags;           // pages keep a tag per object, tag below is unused
+    kmem_ctor_t ctor;
+    kmem_ctor_t dtor;
+    heap_tag tag;               // owner the objects are accounted to, for named caches
+    struct slab_page *partial;  // pages with at least one free object
+    struct slab_page *empty;    // one cached empty page to avoid page thrashing
+    uint32_t pages;             // pages owned by this cache, including the empty one
+    uint32_t in_use;            // objects handed out
+};
+
+// objects start after the header, rounded up so they stay 16 byte aligned
+#define SLAB_HEADER_SIZE ((sizeof(struct slab_page) + 15) & ~(size_t)15)
+
+// the kmalloc size classes, followed by the named caches
+static kmem_cache slab_classes[SLAB_CLASS_COUNT];
+static kmem_cache named_caches[KMEM_CACHE_MAX];
+static int named_cache_count = 0;
+static bool slab_ready = false;
+
+static void cache_setup(kmem_cache *cache, const char *name, size_t size,
+                        kmem_ctor_t ctor, kmem_ctor_t dtor, heap_tag tag, bool object_tags) {
+    cache->name = name;
+    cache->tag = tag;
+    cache->object_tags = object_tags;
+    if (ctor) {
+        // constructed objects must survive the free list, keep the link after them
+        cache->link_offset = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+        cache->object_size = (cache->link_offset + sizeof(void*) + 7) & ~(size_t)7;
+    } else {
+        cache->link_offset = 0;
+        cache->object_size = (size + 7) & ~(size_t)7;
+    }
+    cache->data_offset = SLAB_HEADER_SIZE;
+    if (object_tags) {
+        // room for one tag byte per object, the objects stay 16 byte aligned after them
+        uint32_t tags = (PAGE_SIZE - SLAB_HEADER_SIZE) / (cache->object_size + 1);
+        cache->data_offset = (SLAB_HEADER_SIZE + tags + 15) & ~(size_t)15;
+    }
+    cache->objects_per_page = (PAGE_SIZE - cache->data_offset) / cache->object_size;
+    cache->ctor = ctor;
+    cache->dtor = dtor;
+    cache->partial = NULL;
+    cache->empty = NULL;
+    cache->pages = 0;
+    cache->in_use = 0;
+}
+
+static void slab_init(void) {
+    for (int i = 0; i < SLAB_CLASS_COUNT; i++) {
+        cache_setup(&slab_classes[i], "kmalloc", (size_t)1 << (i + SLAB_MIN_SHIFT),
+                    NULL, NULL, HEAP_TAG_KERNEL, true);
+    }
+    slab_ready = true;
+}
+
+/**
+ * get the size class for a request
+ * @return class index, the smallest class that fits
+ */
+static int slab_class_index(size_t size) {
+    if (size <= SLAB_MIN_SIZE) {
+        return 0;
+    }
+    // round up to the next power of two
+    int shift = 32 - __builtin_clz((uint32_t)(size - 1));
+    return shift - SLAB_MIN_SHIFT;
+}
+
+static struct slab_page *slab_page_of(void *ptr) {
+    return (struct slab_page*)((uintptr_t)ptr & ~(uintptr_t)(PAGE_SIZE - 1));
+}
+
+/**
+ * @return the tag byte of an object in a kmalloc page
+ */
+static uint8_t *slab_tag_of(struct slab_page *page, void *ptr) {
+    uint8_t *base = (uint8_t*)page + page->cache->data_offset;
+    uint32_t index = ((uint8_t*)ptr - base) / page->cache->object_size;
+    return (uint8_t*)page + SLAB_HEADER_SIZE + index;
+}
+
+static void slab_list_remove(struct slab_page **head, struct slab_page *page) {
+    if (page->prev) {
+        page->prev->next = page->next;
+    } else {
+        *head = page->next;
+    }
+    if (page->next) {
+        page->next->prev = page->prev;
+    }
+    page->next = NULL;
+    page->prev = NULL;
+}
+
+static void slab_list_push(struct slab_page **head, struct slab_page *page) {
+    page->prev = NULL;
+    page->next = *head;
+    if (*head) {
+        (*head)->prev = page;
+    }
+    *head = page;
+}
+
+/**
+ * carve a fresh heap page into objects of one cache
+ * @return the new page, or NULL if the heap has no pages left
+ */
+static struct slab_page *slab_page_create(kmem_cache *cache) {
+    struct slab_page *page = (struct slab_page*)heap_page_alloc();
+    if (!page) {
+        return NULL;
+    }
+
+    uint8_t *base = (uint8_t*)page + cache->data_offset;
+    if (cache->ctor) {
+        // zero the whole page in one go, the constructor only sets what is left
+        memset(base, 0, PAGE_SIZE - cache->data_offset);
+        for (int i = 0; i < cache->objects_per_page; i++) {
+            cache->ctor(base + i * cache->object_size);
+        }
+    }
+
+    page->magic = SLAB_MAGIC;
+    page->in_use = 0;
+    page->reserved = 0;
+    page->cache = cache;
+    page->next = NULL;
+    page->prev = NULL;
+
+    // thread the free list through the objects, lowest address first
+    void *head = NULL;
+    for (int i = cache->objects_per_page - 1; i >= 0; i--) {
+        uint8_t *object = base + i * cache->object_size;
+        *(void**)(object + cache->link_offset) = head;
+        head = object;
+    }
+    page->free_list = head;
+
+    cache->pages++;
+    return page;
+}
+
+/**
+ * give a page back to the heap, running the destructor on every object
+ */
+static void slab_page_release(kmem_cache *cache, struct slab_page *page) {
+    if (cache->dtor) {
+        uint8_t *base = (uint8_t*)page + cache->data_offset;
+        for (int i = 0; i < cache->objects_per_page; i++) {
+            cache->dtor(base + i * cache->object_size);
+        }
+    }
+    page->magic = 0;
+    cache->pages--;
+    heap_page_free(page);
+}
+
+static void *cache_alloc(kmem_cache *cache) {
+    struct slab_page *page = cache->partial;
+
+    if (!page) {
+        // reuse the cached empty page before asking the heap
+        if (cache->empty) {
+            page = cache->empty;
+            cache->empty = NULL;
+        } else {
+            page = slab_page_create(cache);
+            if (!page) {
+                return NULL;
+            }
+        }
+        slab_list_push(&cache->partial, page);
+    }
+
+    uint8_t *object = (uint8_t*)page->free_list;
+    page->free_list = *(void**)(object + cache->link_offset);
+    page->in_use++;
+    cache->in_use++;
+
+    // page is full, stop looking at it until something is freed
+    if (!page->free_list) {
+        slab_list_remove(&cache->partial, page);
+    }
+
+    return object;
+}
+
+static void cache_free(kmem_cache *cache, struct slab_page *page, void *ptr) {
+    bool was_full = (page->free_list == NULL);
+
+    *(void**)((uint8_t*)ptr + cache->link_offset) = page->free_list;
+    page->free_list = ptr;
+    page->in_use--;
+    cache->in_use--;
+
+    if (was_full) {
+        slab_list_push(&cache->partial, page);
+    }
+
+    if (page->in_use == 0) {
+        // keep one empty page per cache, give the rest back to the heap
+        slab_list_remove(&cache->partial, page);
+        if (!cache->empty) {
+            cache->empty = page;
+        } else {
+            slab_page_release(cache, page);
+        }
+    }
+}
+
+/**
+ * allocate a small object
+ * @param size requested size, at most SLAB_MAX_SIZE
+ * @param tag owner of the object
+ * @return pointer to the object, or NULL if out of memory
+ */
+void *slab_alloc(size_t size, heap_tag tag) {
+    if (size == 0 || size > SLAB_MAX_SIZE) {
+        return NULL;
+    }
+    if (!slab_ready) {
+        slab_init();
+    }
+
+    void *object = cache_alloc(&slab_classes[slab_class_index(size)]);
+    if (object) {
+        *slab_tag_of(slab_page_of(object), object) = tag;
+    }
+    return object;
+}
+
+/**
+ * free a small object
+ * @param ptr object returned by slab_alloc
+ */
+void slab_free(void *ptr) {
+    struct slab_page *page = slab_page_of(ptr);
+    assert(page->magic == SLAB_MAGIC);
+    assert(page->in_use > 0);
+
+    cache_free(page->cache, page, ptr);
+}
+
+/**
+ * @return usable size of a small object
+ */
+size_t slab_object_size(void *ptr) {
+    struct slab_page *page = slab_page_of(ptr);
+    assert(page->magic == SLAB_MAGIC);
+    return page->cache->object_size;
+}
+
+/**
+ * @return owner of a small object
+ */
+heap_tag slab_object_tag(void *ptr) {
+    struct slab_page *page = slab_page_of(ptr);
+    assert(page->magic == SLAB_MAGIC);
+    if (!page->cache->object_tags) {
+        return page->cache->tag;
+    }
+    return (heap_tag)*slab_tag_of(page, ptr);
+}
+
+/**
+ * create a cache for objects of one type
+ * @param name shown in the cache statistics
+ * @param size object size, at most SLAB_MAX_SIZE
+ * @param ctor puts a new object into its constructed state, may be NULL
+ * @param dtor runs on every object before its page is released, may be NULL
+ * @param tag owner the objects are accounted to
+ * @return the cache, or NULL if the cache table is full
+ */
+kmem_cache *kmem_cache_create(const char *name, size_t size, kmem_ctor_t ctor,
+                              kmem_ctor_t dtor, heap_tag tag) {
+    if (size == 0 || size > SLAB_MAX_SIZE || named_cache_count >= KMEM_CACHE_MAX) {
+        debugf("[SLAB] Cannot create cache\n");
+        return NULL;
+    }
+
+    kmem_cache *cache = &named_caches[named_cache_count++];
+    cache_setup(cache, name, size, ctor, dtor, tag, false);
+    return cache;
+}
+
+/**
+ * allocate an object from a cache
+ * @return a constructed object, or NULL if out of memory
+ */
+void *kmem_cache_alloc(kmem_cache *cache) {
+    if (!cache) {
+        return NULL;
+    }
+
+    void *object = cache_alloc(cache);
+    if (object) {
+        heap_tag_alloc(cache->tag, cache->object_size);
+    } else {
+        heap_tag_fail(cache->tag);
+    }
+    return object;
+}
+
+/**
+ * return an object to its cache
+ * @note the object must be back in its constructed state
+ */
+void kmem_cache_free(kmem_cache *cache, void *ptr) {
+    if (!cache || !ptr) {
+        return;
+    }
+    struct slab_page *page = slab_page_of(ptr);
+    assert(page->magic == SLAB_MAGIC);
+    assert(page->cache == cache);
+    assert(page->in_use > 0);
+
+    heap_tag_free(cache->tag, cache->object_size);
+    cache_free(cache, page, ptr);
+}
+
+void kmem_cache_get_stats(kmem_cache *cache, kmem_cache_stats *stats) {
+    stats->name = cache->name;
+    stats->object_size = cache->object_size;
+    stats->objects_in_use = cache->in_use;
+    stats->objects_total = cache->pages * cache->objects_per_page;
+    stats->pages = cache->pages;
+}
@@ -0,0 +1,71 @@
+/*
+    MooseOS Pre-zeroed frame pool
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Frames that are zeroed while the system is idle, so page tables
+    and demand-zero pages do not have to clear 4KB when they need it.
+*/
+
+#include "zeropool/zeropool.h"
+#include "frame/frame.h"
+
+static uint32_t pool[ZERO_POOL_SIZE];
+static uint32_t pool_count = 0;
+static uint32_t pool_hits = 0;
+static uint32_t pool_misses = 0;
+
+/**
+ * clear one frame a dword at a time
+ * @note physical memory is identity mapped, so the frame is its own address
+ */
+static void zero_frame(uint32_t frame) {
+    void *dest = (void*)frame;
+    uint32_t count = FRAME_SIZE / 4;
+    asm volatile("cld; rep stosl" : "+D"(dest), "+c"(count) : "a"(0) : "memory");
+}
+
+/**
+ * allocate a zeroed frame, from the pool if it has one
+ * @return physical address of the frame, or 0 if memory is exhausted
+ */
+uint32_t zero_pool_alloc(void) {
+    if (pool_count) {
+        pool_hits++;
+        return pool[--pool_count];
+    }
+
+    uint32_t frame = frame_alloc_order(0);
+    if (frame) {
+        pool_misses++;
+        zero_frame(frame);
+    }
+    return frame;
+}
+
+/**
+ * zero a few frames ahead of time, call this when there is nothing else to do
+ * @param budget most frames to zero in this call
+ * @return true if there is nothing left to do, the pool is full or no frames can be spared
+ */
+bool zero_pool_refill(uint32_t budget) {
+    while (budget-- && pool_count < ZERO_POOL_SIZE) {
+        // keep the last frames for allocations that cannot wait
+        if (frame_free_count() <= ZERO_POOL_SIZE) {
+            return true;
+        }
+        uint32_t frame = frame_alloc_order(0);
+        if (!frame) {
+            return true;
+        }
+        zero_frame(frame);
+        pool[pool_count++] = frame;
+    }
+    return pool_count == ZERO_POOL_SIZE;
+}
+
+void zero_pool_get_stats(zero_pool_stats *stats) {
+    stats->ready = pool_count;
+    stats->hits = pool_hits;
+    stats->misses = pool_misses;
+}
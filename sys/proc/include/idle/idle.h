@@ -0,0 +1,36 @@
+/*
+    MooseOS Idle
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define IDLE_QUIET_PASSES 3    // main loop passes without new input before sleeping
+#define IDLE_MAX_SLEEP_MS 1000 // when nothing else sets a deadline
+
+typedef struct {
+    uint64_t idle_ns;   // time spent halted since boot
+    uint64_t uptime_ns; // time since the clocksource started
+    uint32_t sleeps;    // times the main loop went to sleep
+    uint32_t wakeups;   // interrupts that ended a halt
+} idle_stats;
+
+extern volatile uint32_t idle_wake_events;
+
+/**
+ * note that an interrupt brought work for the main loop,
+ * called from the keyboard, mouse and serial handlers
+ */
+static inline void idle_wake(void) {
+    idle_wake_events++;
+}
+
+void idle_pass(bool busy, uint32_t max_sleep_ms);
+void idle_halt(uint32_t max_sleep_ms);
+void idle_get_stats(idle_stats *stats);
+
+#endif // IDLE_H
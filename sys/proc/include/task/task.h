@@ -20,6 +20,7 @@ typedef void (*task_func)();
 typedef enum {
     TASK_READY,
     TASK_RUNNING,
+    TASK_SLEEPING, // waits for its wake timer in task_sleep
     TASK_FINISHED
 } task_state;
 
@@ -33,6 +34,7 @@ typedef struct {
 void task_init();
 int task_create(void (*entry)(void));
 void task_yield();
+void task_sleep(uint32_t ms);
 void task_schedule();
 void task_start(void);
 void register_task(task_func task);
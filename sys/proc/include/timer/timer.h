@@ -0,0 +1,33 @@
+/*
+    MooseOS Kernel timers
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+*/
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void (*timer_func)(void *data);
+
+// a callback to run once a number of milliseconds have passed
+typedef struct ktimer {
+    struct ktimer *next;
+    struct ktimer **pprev; // the pointer to this timer, NULL when not pending
+    uint32_t expires;      // system_ms value it is due at
+    uint32_t period_ms;    // re-armed this far ahead after each run, 0 for once
+    timer_func func;
+    void *data;
+} ktimer;
+
+void timer_setup(ktimer *timer, timer_func func, void *data);
+void timer_add(ktimer *timer, uint32_t delay_ms);
+void timer_add_periodic(ktimer *timer, uint32_t period_ms);
+bool timer_cancel(ktimer *timer);
+bool timer_pending(const ktimer *timer);
+void timer_run(void);
+uint32_t timer_ms_until_next(uint32_t max_ms);
+
+#endif // TIMER_H
@@ -0,0 +1,109 @@
+/*
+    MooseOS Idle
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    The main loop polls for its work, so it cannot tell when there is
+    none. Interrupts that bring work count a wake event instead, and
+    once a few passes in a row saw no new events the CPU halts until
+    the next one.
+
+    While halted the periodic tick is stopped and the PIT interrupts
+    once per deadline instead (tickless). The tick counters are caught
+    up from the clocksource afterwards.
+*/
+
+#include "idle/idle.h"
+#include "pit/pit.h"
+#include "prof/prof.h"
+#include "clocksource/clocksource.h"
+#include "trace/trace.h"
+#include "tsc/tsc.h"
+#include "io/io.h"
+
+volatile uint32_t idle_wake_events = 0;
+
+static uint32_t seen_events = 0;
+static uint32_t quiet_passes = 0;
+static uint64_t idle_ns = 0;
+static uint32_t sleeps = 0;
+static uint32_t wakeups = 0;
+
+/**
+ * halt until an interrupt brings work or the time is up
+ * @param events wake events seen so far
+ */
+static void idle_sleep(uint32_t events, uint32_t max_sleep_ms) {
+    bool timed = clocksource_ready();
+    // the profiler needs every tick, it still gets halts to sample
+    bool tickless = timed && !prof_running;
+    uint64_t start = ktime_ns();
+    uint64_t deadline = start + (uint64_t)max_sleep_ms * 1000000;
+    sleeps++;
+    TRACE_BEGIN(TRACE_IDLE, max_sleep_ms, 0);
+
+    unsigned long flags = irq_save();
+    while (idle_wake_events == events) {
+        uint64_t now = ktime_ns();
+        if (timed && now >= deadline) {
+            break;
+        }
+        if (tickless) {
+            uint64_t left = deadline - now;
+            if (left > (uint64_t)PIT_ONESHOT_MAX_US * 1000) {
+                left = (uint64_t)PIT_ONESHOT_MAX_US * 1000;
+            }
+            pit_oneshot(div64_32(left + 999, 1000));
+        }
+        // sti holds interrupts off for one more instruction, so none slips in before hlt
+        asm volatile("sti\n\thlt\n\tcli" : : : "memory");
+        wakeups++;
+        if (!timed) {
+            break; // no clock to sleep longer by, go back on the next tick
+        }
+    }
+
+    uint64_t slept = ktime_ns() - start;
+    if (tickless) {
+        pit_resume_tick(slept);
+    }
+    idle_ns += slept;
+    irq_restore(flags);
+    TRACE_END(TRACE_IDLE, max_sleep_ms, wakeups);
+}
+
+/**
+ * end of a main loop pass, sleeps once passes have been quiet for a while
+ * @param busy the pass left work for the next one, do not sleep
+ * @param max_sleep_ms wake up after this long even without input
+ */
+void idle_pass(bool busy, uint32_t max_sleep_ms) {
+    uint32_t events = idle_wake_events;
+    if (busy || events != seen_events) {
+        seen_events = events;
+        quiet_passes = 0;
+        return;
+    }
+    // input handling is spread over passes (one key, cursor every other pass)
+    if (++quiet_passes < IDLE_QUIET_PASSES || max_sleep_ms == 0) {
+        return;
+    }
+    idle_sleep(events, max_sleep_ms);
+}
+
+/**
+ * halt right away until the next interrupt brings work or the time is up
+ * @note for waits outside the main loop, which cannot tell what is work
+ */
+void idle_halt(uint32_t max_sleep_ms) {
+    if (max_sleep_ms) {
+        idle_sleep(idle_wake_events, max_sleep_ms);
+    }
+}
+
+void idle_get_stats(idle_stats *stats) {
+    stats->idle_ns = idle_ns;
+    stats->uptime_ns = ktime_ns();
+    stats->sleeps = sleeps;
+    stats->wakeups = wakeups;
+}
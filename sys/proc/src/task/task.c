@@ -5,7 +5,11 @@
 */
 
 #include "task/task.h"
+#include "timer/timer.h"
+#include "idle/idle.h"
+#include "clocksource/clocksource.h"
 #include "print/debug.h"
+#include "trace/trace.h"
 
 static task tasks[MAX_TASKS];
 static int current_task = -1;
@@ -84,6 +88,44 @@ void task_yield() {
     task_tick();
 }
 
+static void task_wake(void *data) {
+    task *sleeper = data;
+    if (sleeper->state == TASK_SLEEPING) {
+        sleeper->state = TASK_READY;
+    }
+}
+
+/**
+ * block the calling task for ms milliseconds, to the tick, other tasks run meanwhile
+ * @note with no other task ready the CPU halts until the wake timer is due,
+ * running the timers itself since the main loop may be the task asleep
+ */
+void task_sleep(uint32_t ms) {
+    if (current_task < 0) {
+        mdelay(ms); // the task system has not started
+        return;
+    }
+    task *self = &tasks[current_task];
+    ktimer wake;
+    timer_setup(&wake, task_wake, self);
+    self->state = TASK_SLEEPING;
+    timer_add(&wake, ms);
+
+    while (self->state == TASK_SLEEPING) {
+        task_schedule();
+        if (self->state != TASK_SLEEPING) {
+            break;
+        }
+        timer_run();
+        if (self->state == TASK_SLEEPING) {
+            idle_halt(timer_ms_until_next(IDLE_MAX_SLEEP_MS));
+        }
+    }
+    // still ready if our own timer_run woke us rather than a switch back
+    self->state = TASK_RUNNING;
+    timer_cancel(&wake);
+}
+
 void task_schedule() {
     if (num_tasks == 0) {
         debugf("[TASK] No tasks to schedule!\n");
@@ -107,6 +149,7 @@ void task_schedule() {
             
             // perform task switch if we have a previous task
             if (prev_task != -1 && prev_task != current_task) {
+                TRACE_INSTANT(TRACE_TASK_SWITCH, prev_task, current_task);
                 task_switch(&tasks[prev_task].stack_ptr, tasks[current_task].stack_ptr);
             }
             return;
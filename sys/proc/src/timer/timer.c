@@ -0,0 +1,235 @@
+/*
+    MooseOS Kernel timers
+    Copyright (c) 2025 Ethan Zhang
+    Licensed under the MIT license. See license file for details
+
+    Pending timers hang off a hierarchical wheel keyed by system_ms, so
+    a wheel tick is a millisecond whatever rate the profiler runs the
+    PIT at. The root wheel has a slot per tick for the next 256 ticks.
+    Each level above it has 64 slots that each cover 64 slots of the
+    level below. Whenever the root wheel wraps, the next slot of the first
+    level is cascaded, i.e. its timers are inserted again and land
+    lower down, and so on upwards. Adding and cancelling a timer is a
+    list insert or unlink, whatever the number of timers.
+
+    Callbacks draw and touch the filesystem, so they run from
+    timer_run() in the main loop rather than from the timer interrupt.
+    The wheel catches up on every tick since the last run, which is
+    many at once after a tickless sleep.
+*/
+
+#include "timer/timer.h"
+#include "pit/pit.h"
+
+#define ROOT_BITS   8
+#define LEVEL_BITS  6
+#define LEVELS      3
+#define ROOT_SIZE   (1 << ROOT_BITS)
+#define ROOT_MASK   (ROOT_SIZE - 1)
+#define LEVEL_SIZE  (1 << LEVEL_BITS)
+#define LEVEL_MASK  (LEVEL_SIZE - 1)
+#define MAX_TICKS   ((1u << (ROOT_BITS + LEVELS * LEVEL_BITS)) - 1) // about 18 hours
+
+// slot of level that tick falls in
+#define LEVEL_INDEX(tick, level) (((tick) >> (ROOT_BITS + (level) * LEVEL_BITS)) & LEVEL_MASK)
+
+static ktimer *root_wheel[ROOT_SIZE];
+static ktimer *level_wheel[LEVELS][LEVEL_SIZE];
+static uint32_t wheel_tick = 0; // next tick to run, slots before it are done
+static uint32_t pending = 0;
+
+static void slot_insert(ktimer **slot, ktimer *timer) {
+    timer->next = *slot;
+    if (*slot) {
+        (*slot)->pprev = &timer->next;
+    }
+    *slot = timer;
+    timer->pprev = slot;
+}
+
+static void slot_remove(ktimer *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+static void wheel_insert(ktimer *timer) {
+    uint32_t delta = timer->expires - wheel_tick;
+    if ((int32_t)delta < 0) {
+        // already due, goes with the next tick run
+        slot_insert(&root_wheel[wheel_tick & ROOT_MASK], timer);
+        return;
+    }
+    if (delta < ROOT_SIZE) {
+        slot_insert(&root_wheel[timer->expires & ROOT_MASK], timer);
+        return;
+    }
+    if (delta > MAX_TICKS) {
+        timer->expires = wheel_tick + MAX_TICKS;
+        delta = MAX_TICKS;
+    }
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= 1u << (ROOT_BITS + (level + 1) * LEVEL_BITS)) {
+        level++;
+    }
+    slot_insert(&level_wheel[level][LEVEL_INDEX(timer->expires, level)], timer);
+}
+
+/**
+ * insert the timers of the current slot of a level again
+ * @return the slot, 0 means this level wrapped too
+ */
+static uint32_t cascade(int level) {
+    uint32_t index = LEVEL_INDEX(wheel_tick, level);
+    ktimer *timer = level_wheel[level][index];
+    level_wheel[level][index] = NULL;
+    while (timer) {
+        ktimer *next = timer->next;
+        wheel_insert(timer);
+        timer = next;
+    }
+    return index;
+}
+
+static void arm(ktimer *timer, uint32_t delay_ms) {
+    if (timer->pprev) {
+        slot_remove(timer);
+    } else {
+        pending++;
+    }
+    timer->expires = system_ms + delay_ms;
+    wheel_insert(timer);
+}
+
+void timer_setup(ktimer *timer, timer_func func, void *data) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->period_ms = 0;
+    timer->func = func;
+    timer->data = data;
+}
+
+/**
+ * run a timer once
+ * @param delay_ms from now
+ * @note a pending timer is moved to the new time
+ */
+void timer_add(ktimer *timer, uint32_t delay_ms) {
+    timer->period_ms = 0;
+    arm(timer, delay_ms);
+}
+
+/**
+ * run a timer every period_ms until it is cancelled
+ * @note runs that were missed while the main loop was busy are skipped, not made up
+ */
+void timer_add_periodic(ktimer *timer, uint32_t period_ms) {
+    timer->period_ms = period_ms;
+    arm(timer, period_ms);
+}
+
+/**
+ * @return true if the timer was pending
+ * @note safe to call from a callback, also on the timer being run
+ */
+bool timer_cancel(ktimer *timer) {
+    if (!timer->pprev) {
+        return false;
+    }
+    slot_remove(timer);
+    timer->period_ms = 0;
+    pending--;
+    return true;
+}
+
+bool timer_pending(const ktimer *timer) {
+    return timer->pprev != NULL;
+}
+
+/**
+ * run the callbacks of every timer that is due
+ * @note callbacks must not sleep, the timers would stop with them
+ */
+void timer_run(void) {
+    uint32_t now = system_ms;
+    if (!pending) {
+        wheel_tick = now + 1; // the slots are all empty, skip ahead
+        return;
+    }
+    while ((int32_t)(now - wheel_tick) >= 0) {
+        uint32_t index = wheel_tick & ROOT_MASK;
+        if (index == 0) {
+            for (int level = 0; level < LEVELS && cascade(level) == 0; level++) {
+            }
+        }
+
+        // timers a callback adds for now go in the next slot, not this one
+        ktimer *due = root_wheel[index];
+        root_wheel[index] = NULL;
+        if (due) {
+            due->pprev = &due;
+        }
+        wheel_tick++;
+
+        while (due) {
+            ktimer *timer = due;
+            slot_remove(timer);
+            if (timer->period_ms) {
+                // the callback may still cancel or move it
+                timer->expires += timer->period_ms;
+                if ((int32_t)(timer->expires - now) <= 0) {
+                    timer->expires = now + timer->period_ms;
+                }
+                wheel_insert(timer);
+            } else {
+                pending--;
+            }
+            timer->func(timer->data);
+        }
+    }
+}
+
+/**
+ * @return milliseconds until the next timer is due, at most max_ms, 0 if one is due now
+ * @note for the idle deadline, it walks the wheel
+ */
+uint32_t timer_ms_until_next(uint32_t max_ms) {
+    if (!pending) {
+        return max_ms;
+    }
+
+    // the first used root slot holds the soonest root timers
+    int32_t soonest = (int32_t)MAX_TICKS;
+    for (uint32_t i = 0; i < ROOT_SIZE; i++) {
+        ktimer *timer = root_wheel[(wheel_tick + i) & ROOT_MASK];
+        if (timer) {
+            for (; timer; timer = timer->next) {
+                int32_t left = (int32_t)(timer->expires - system_ms);
+                if (left < soonest) {
+                    soonest = left;
+                }
+            }
+            break;
+        }
+    }
+    // timers further out are few, look at them all
+    for (int level = 0; level < LEVELS; level++) {
+        for (uint32_t i = 0; i < LEVEL_SIZE; i++) {
+            for (ktimer *timer = level_wheel[level][i]; timer; timer = timer->next) {
+                int32_t left = (int32_t)(timer->expires - system_ms);
+                if (left < soonest) {
+                    soonest = left;
+                }
+            }
+        }
+    }
+
+    if (soonest <= 0) {
+        return 0;
+    }
+    return (uint32_t)soonest < max_ms ? (uint32_t)soonest : max_ms;
+}
@@ -7,16 +7,27 @@
 #include <stdbool.h>
 #include "cpuid/cpuid.h"
 
+static int qemu_detected = -1; // -1 until the first call
+
 /**
  * @note we can't use debugf() here because we haven't even proved we are in QEMU yet
+ * @note CPUID exits to the hypervisor, so the answer is worked out once and kept
  */
 bool detect_qemu(void) {
+    if (qemu_detected >= 0) {
+        return qemu_detected;
+    }
+
     uint32_t eax, ebx, ecx, edx;
     cpuid(1, &eax,&ebx,&ecx,&edx);
     // ECX bit 31 = hypervisor
-    if (!(ecx & (1 << 31))) return false;
+    if (!(ecx & (1 << 31))) {
+        qemu_detected = false;
+        return false;
+    }
 
     cpuid(0x40000000, &eax,&ebx,&ecx,&edx);
     // hypervisor vendor string is usually "TCGTCGTCG" or "KVMKVMKVM"
-    return (ebx || ecx || edx); // just check non-zero vendor string
+    qemu_detected = (ebx || ecx || edx); // just check non-zero vendor string
+    return qemu_detected;
 }
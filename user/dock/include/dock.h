@@ -18,6 +18,7 @@
 #include "terminal.h"
 #include "rtc/rtc.h"
 #include "mouse/mouse.h"
+#include "timer/timer.h"
 
 // type
 typedef unsigned short uint16_t;
@@ -43,6 +44,9 @@ extern void gui_clear_mouse(void);
 // height of title bar
 #define TITLE_BAR_HEIGHT 20
 
+// how often the clock is redrawn
+#define DOCK_TIME_UPDATE_MS 2000
+
 // size of file area
 #define FILE_AREA_X (WINDOW_X + 8)
 #define FILE_AREA_Y (WINDOW_Y + TITLE_BAR_HEIGHT + 8)
@@ -82,7 +86,6 @@ extern int filesystem_make_file(const char* name, const char* content);
 // function prototypes
 void dock_create_open_file(void);
 bool dock_handle_mouse(void);
-void dock_update_time(void);
 void dock_init(void);
 
 // this variable is for the 'New File' dialog.
@@ -9,12 +9,13 @@
 // variables
 static int selected_app = 0;  // 0 = file explorer, 1 = text editor, 2 = terminal
 static const int total_apps = 3;  
-static uint32_t last_time_update = 0;  // last update
+static ktimer clock_timer;  // redraws the time while the dock is shown
 static char last_time_str[32] = ""; // time cache (string)
 
 // static function declarations
 static void launch_selected_app(void);
 static bool dock_handle_mouse_click(int mouse_x, int mouse_y);
+static void dock_clock_tick(void *data);
 
 /**
  * draw file explorer window border
@@ -556,6 +557,8 @@ bool dock_handle_key(unsigned char key, char scancode) {
 void dock_init() {
     selected_app = 0;
     draw_dock();
+    timer_setup(&clock_timer, dock_clock_tick, NULL);
+    timer_add_periodic(&clock_timer, DOCK_TIME_UPDATE_MS);
 }
 
 /**
@@ -648,15 +651,11 @@ bool dock_handle_mouse() {
 }
 
 /**
- * update time display
+ * redraw the time, runs every DOCK_TIME_UPDATE_MS
  */
-void dock_update_time() {
-    static uint32_t last_time_update = 0;
-    static uint32_t last_mouse_recovery = 0;
-    static uint32_t time_update_frequency = 2000;
-
-    if (dock_is_active() && (ticks - last_time_update >= time_update_frequency)) {
+static void dock_clock_tick(void *data) {
+    (void)data;
+    if (dock_is_active()) {
         draw_time();
-        last_time_update = ticks;
     }
-}
\ No newline at end of file
+}
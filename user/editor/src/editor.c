@@ -195,6 +195,7 @@ void editor_open(const char* filename) {
         }
         // end file
         editor_content[i] = '\0';
+        put_file_content(filename);
     } else {
         // file is empty, end file
         editor_content[0] = '\0';
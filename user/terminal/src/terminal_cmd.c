@@ -8,11 +8,44 @@
 #include "speaker/speaker.h"
 #include "stdlib/stdlib.h"
 #include "elf/elf.h"
+#include "frame/frame.h"
+#include "arena/arena.h"
+#include "large/large.h"
+#include "paging/paging.h"
+#include "zeropool/zeropool.h"
+#include "tsc/tsc.h"
+#include "print/debug.h"
+#include "serial/serial.h"
+#include "trace/trace.h"
+#include "prof/prof.h"
+#include "idle/idle.h"
+#include "clocksource/clocksource.h"
+#include "task/task.h"
+
+#define COMMAND_SCRATCH_SIZE 4096
+#define DMESG_BYTES 1024 // about a screen of log lines
+
+// scratch memory for one command, released when the command returns
+static uint8_t command_scratch_memory[COMMAND_SCRATCH_SIZE];
+static arena command_scratch = {
+    .name = "terminal",
+    .base = command_scratch_memory,
+    .size = COMMAND_SCRATCH_SIZE,
+};
+
+// whole percent of part in total, both in nanoseconds
+static uint32_t percent_of(uint64_t part, uint64_t total) {
+    uint32_t total_ms = div64_32(total, 1000000);
+    if (total_ms == 0) {
+        return 0;
+    }
+    return div64_32((uint64_t)div64_32(part, 1000000) * 100, total_ms);
+}
 
 /**
  * @todo this function is extremely inefficient and very long
  */
-void term_exec_cmd(const char* cmd) {
+static void exec_cmd(const char* cmd) {
     // strip whitespace
     cmd = strip_whitespace(cmd);
     
@@ -41,6 +74,12 @@ void term_exec_cmd(const char* cmd) {
         terminal_print("cat <file> - Show file content");
         terminal_print("diskinfo - Show disk information");
         terminal_print("memstats - Show memory statistics");
+        terminal_print("heapstat - Show heap usage per subsystem");
+        terminal_print("dmesg - Show recent kernel log");
+        terminal_print("trace [on|off|dump] - Event tracer");
+        terminal_print("prof [start [hz]|stop|dump] - CPU profiler");
+        terminal_print("cpustat - Show idle time and clock");
+        terminal_print("sleep <ms> - Wait, the CPU halts meanwhile");
         terminal_print("save - Save current filesystem to disk");
         terminal_print("load - Load filesystem from disk");
         terminal_print("systest - Run system tests");
@@ -138,11 +177,15 @@ void term_exec_cmd(const char* cmd) {
                 File* child = cwd->folder.children[i];
                 if (child && child->type == FILE_NODE && strcmp(child->name, filename)) {
                     found = true;
-                    if (child->file.content && child->file.content_size > 0) {
-                        terminal_print(child->file.content);
+                    char* content = file_get_content(child);
+                    if (content && child->file.content_size > 0) {
+                        terminal_print(content);
                     } else {
                         terminal_print("File is empty");
                     }
+                    if (content) {
+                        file_put_content(child);
+                    }
                     break;
                 }
             }
@@ -262,8 +305,8 @@ void term_exec_cmd(const char* cmd) {
     }
     // show disk info
     else if (strcmp(cmd, "diskinfo")) {
-        char info_buffer[512];
-        if (filesystem_get_disk_info(info_buffer, sizeof(info_buffer)) == 0) {
+        char *info_buffer = arena_alloc(&command_scratch, 512);
+        if (info_buffer && filesystem_get_disk_info(info_buffer, 512) == 0) {
             char *line_start = info_buffer;
             char *line_end;
             
@@ -289,8 +332,8 @@ void term_exec_cmd(const char* cmd) {
     }
     
     else if (strcmp(cmd, "memstats")) {
-        char stats_buffer[512];
-        if (filesystem_get_memory_stats(stats_buffer, sizeof(stats_buffer)) == 0) {
+        char *stats_buffer = arena_alloc(&command_scratch, 512);
+        if (stats_buffer && filesystem_get_memory_stats(stats_buffer, 512) == 0) {
             char *line_start = stats_buffer;
             char *line_end;
             
@@ -313,6 +356,198 @@ void term_exec_cmd(const char* cmd) {
         } else {
             terminal_print_error("Failed to get memory statistics");
         }
+
+        // heap fragmentation
+        heap_stats heap;
+        heap_get_stats(&heap);
+        char line[CHARS_PER_LINE + 1];
+        msnprintf(line, sizeof(line), "Heap free: %u bytes, largest extent: %u bytes",
+                  (uint32_t)heap.total_free, (uint32_t)heap.largest_free);
+        terminal_print(line);
+
+        // physical frames
+        msnprintf(line, sizeof(line), "Frames used: %u, free: %u",
+                  frame_used_count(), frame_free_count());
+        terminal_print(line);
+
+        // demand paging
+        page_fault_stats faults;
+        paging_get_fault_stats(&faults);
+        uint32_t average = faults.minor_faults ? div64_32(faults.total_cycles, faults.minor_faults) : 0;
+        msnprintf(line, sizeof(line), "Minor faults: %u, avg %u cycles, max %u",
+                  faults.minor_faults, average, faults.max_cycles);
+        terminal_print(line);
+        msnprintf(line, sizeof(line), "Copy-on-write breaks: %u", faults.cow_breaks);
+        terminal_print(line);
+
+        // pre-zeroed frames
+        zero_pool_stats pool;
+        zero_pool_get_stats(&pool);
+        msnprintf(line, sizeof(line), "Zero pool: %u ready, %u hits, %u misses",
+                  pool.ready, pool.hits, pool.misses);
+        terminal_print(line);
+    }
+
+    // dmesg - recent kernel log
+    else if (strcmp(cmd, "dmesg")) {
+        char *log = arena_alloc(&command_scratch, DMESG_BYTES);
+        if (!log) {
+            terminal_print_error("Not enough memory for the log");
+        } else {
+            size_t len = debug_log_copy(log, DMESG_BYTES);
+            char *line_start = log;
+            // the first line is cut off unless the whole log fit
+            if (len == DMESG_BYTES - 1) {
+                while (*line_start && *line_start != '\n') {
+                    line_start++;
+                }
+                if (*line_start == '\n') {
+                    line_start++;
+                }
+            }
+            while (*line_start) {
+                char *line_end = line_start;
+                while (*line_end && *line_end != '\n') {
+                    line_end++;
+                }
+                char temp_char = *line_end;
+                *line_end = '\0';
+                terminal_print(line_start);
+                *line_end = temp_char;
+                line_start = *line_end ? line_end + 1 : line_end;
+            }
+            if (debug_log_dropped()) {
+                char line[CHARS_PER_LINE + 1];
+                msnprintf(line, sizeof(line), "(%u bytes lost before reaching serial)",
+                          debug_log_dropped());
+                terminal_print(line);
+            }
+            serial_stats serial;
+            serial_get_stats(&serial);
+            char line[CHARS_PER_LINE + 1];
+            msnprintf(line, sizeof(line), "Serial: %u B out in %u irqs, %u B in%s",
+                      serial.tx_bytes, serial.tx_interrupts, serial.rx_bytes,
+                      serial.fifo ? "" : ", no FIFO");
+            terminal_print(line);
+        }
+    }
+
+    else if (strcmp(cmd, "trace")) {
+        trace_stats stats;
+        trace_get_stats(&stats);
+        char line[CHARS_PER_LINE + 1];
+        msnprintf(line, sizeof(line), "Trace %s: %u events, %u overwritten",
+                  stats.enabled ? "on" : "off", stats.recorded, stats.overwritten);
+        terminal_print(line);
+    }
+
+    else if (strcmp(cmd, "trace on")) {
+        trace_set_enabled(true);
+        terminal_print("Tracing on");
+    }
+
+    else if (strcmp(cmd, "trace off")) {
+        trace_set_enabled(false);
+        terminal_print("Tracing off");
+    }
+
+    else if (strcmp(cmd, "trace dump")) {
+        char line[CHARS_PER_LINE + 1];
+        uint32_t count = trace_dump();
+        msnprintf(line, sizeof(line), "Sent %u events to serial", count);
+        terminal_print(line);
+        terminal_print("Convert with scripts/trace_to_chrome.py");
+    }
+
+    else if (strcmp(cmd, "prof")) {
+        prof_stats stats;
+        prof_get_stats(&stats);
+        char line[CHARS_PER_LINE + 1];
+        msnprintf(line, sizeof(line), "Profiler %s: %u samples at %u Hz, %u dropped",
+                  stats.running ? "running" : "stopped", stats.samples, stats.hz, stats.dropped);
+        terminal_print(line);
+    }
+
+    else if (strcmp(cmd, "prof start") || strncmp(cmd, "prof start ", 11) == 0) {
+        uint32_t hz = cmd[10] ? atoi(cmd + 11) : PROF_DEFAULT_HZ;
+        prof_start(hz);
+        prof_stats stats;
+        prof_get_stats(&stats);
+        char line[CHARS_PER_LINE + 1];
+        msnprintf(line, sizeof(line), "Profiling at %u Hz", stats.hz);
+        terminal_print(line);
+    }
+
+    else if (strcmp(cmd, "prof stop")) {
+        prof_stop();
+        prof_stats stats;
+        prof_get_stats(&stats);
+        char line[CHARS_PER_LINE + 1];
+        msnprintf(line, sizeof(line), "Profiler stopped, %u samples", stats.samples);
+        terminal_print(line);
+    }
+
+    else if (strcmp(cmd, "prof dump")) {
+        char line[CHARS_PER_LINE + 1];
+        uint32_t count = prof_dump();
+        msnprintf(line, sizeof(line), "Sent %u samples to serial", count);
+        terminal_print(line);
+        terminal_print("Fold with scripts/prof_fold.py");
+    }
+
+    else if (strcmp(cmd, "cpustat")) {
+        static idle_stats last; // the first call covers the time since boot
+        idle_stats now;
+        idle_get_stats(&now);
+        uint32_t window_s = div64_32(now.uptime_ns - last.uptime_ns, 1000000000);
+        char line[CHARS_PER_LINE + 1];
+        msnprintf(line, sizeof(line), "Clock: %s, TSC at %u kHz, up %u s",
+                  clocksource_name(), clocksource_tsc_khz(), (uint32_t)div64_32(now.uptime_ns, 1000000000));
+        terminal_print(line);
+        msnprintf(line, sizeof(line), "Idle: %u%% since boot, %u%% in the last %u s",
+                  percent_of(now.idle_ns, now.uptime_ns),
+                  percent_of(now.idle_ns - last.idle_ns, now.uptime_ns - last.uptime_ns), window_s);
+        terminal_print(line);
+        msnprintf(line, sizeof(line), "Halts: %u sleeps, %u wakeups",
+                  now.sleeps - last.sleeps, now.wakeups - last.wakeups);
+        terminal_print(line);
+        last = now;
+    }
+
+    else if (strncmp(cmd, "sleep ", 6) == 0) {
+        int ms = atoi(cmd + 6);
+        if (ms > 0) {
+            task_sleep(ms);
+        }
+    }
+
+    // heapstat - heap usage per tag
+    else if (strcmp(cmd, "heapstat")) {
+        char line[CHARS_PER_LINE + 1];
+        terminal_print("Heap by tag (live/peak bytes):");
+        for (int tag = 0; tag < HEAP_TAG_COUNT; tag++) {
+            heap_tag_stats stats;
+            heap_get_tag_stats(tag, &stats);
+            msnprintf(line, sizeof(line), "%s %u/%u B, %u allocs, %u fails",
+                      stats.name, (uint32_t)stats.live_bytes, (uint32_t)stats.peak_bytes,
+                      stats.allocations, stats.failures);
+            terminal_print(line);
+        }
+        large_stats large;
+        large_get_stats(&large);
+        msnprintf(line, sizeof(line), "Large objects: %u in %u pages, peak %u pages",
+                  large.objects, large.pages, large.peak_pages);
+        terminal_print(line);
+        for (uint32_t i = 0; i < heap_shrinker_count(); i++) {
+            heap_shrinker_stats shrinker;
+            heap_get_shrinker_stats(i, &shrinker);
+            msnprintf(line, sizeof(line), "Shrinker %s: %u calls, %u B reclaimed",
+                      shrinker.name, shrinker.calls, (uint32_t)shrinker.reclaimed_bytes);
+            terminal_print(line);
+        }
+        msnprintf(line, sizeof(line), "Command scratch peak: %u/%u bytes",
+                  (uint32_t)command_scratch.peak, (uint32_t)command_scratch.size);
+        terminal_print(line);
     }
 
     // save - save current filesystem to disk
@@ -488,10 +723,11 @@ void term_exec_cmd(const char* cmd) {
                 File* child = cwd->folder.children[i];
                 if (child && child->type == FILE_NODE && strcmp(child->name, filename)) {
                     found = true;
-                    if (child->file.content && child->file.content_size > 0) {
+                    char* content = file_get_content(child);
+                    if (content && child->file.content_size > 0) {
                         // parse the ELF file
                         elf_load_info load_info;
-                        bool parse_result = elf_parse(child->file.content, &load_info);
+                        bool parse_result = elf_parse(content, &load_info);
                         
                         if (parse_result) {
                             terminal_print("ELF file validation successful!");
@@ -512,6 +748,9 @@ void term_exec_cmd(const char* cmd) {
                     } else {
                         terminal_print_error("File is empty");
                     }
+                    if (content) {
+                        file_put_content(child);
+                    }
                     break;
                 }
             }
@@ -529,3 +768,8 @@ void term_exec_cmd(const char* cmd) {
         terminal_print("Type 'help' for commands");
     }
 }
+
+void term_exec_cmd(const char* cmd) {
+    exec_cmd(cmd);
+    arena_reset(&command_scratch);
+}